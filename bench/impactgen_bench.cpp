@@ -0,0 +1,641 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmarks of the building blocks of impactgen (micro benchmarks) and of whole joins of the impacts on generated inputs (end-to-end
+// benchmarks), as well as a thread and grid scaling study of whole impactgen runs. Results are written as JSON to track performance
+// across versions.
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "AgentForcing.h"
+#include "ForcingSeries.h"
+#include "Generator.h"
+#include "GeoGrid.h"
+#include "GridCache.h"
+#include "Output.h"
+#include "ReferenceTime.h"
+#include "impacts/Flooding.h"
+#include "impacts/HeatLaborProductivity.h"
+#include "impacts/TropicalCyclones.h"
+#include "nvector.h"
+#include "settingsnode.h"
+#include "settingsnode/yaml.h"
+#include "version.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+struct Options {
+    std::vector<double> resolutions = {0.5, 1.0 / 12, 1.0 / 120};  // 0.5°, 5', 30"
+    std::size_t region_count = 100;
+    std::size_t timestep_count = 30;
+    std::size_t event_count = 10;
+    std::vector<int> thread_counts = {1};
+    std::size_t repetitions = 3;
+    std::size_t max_cells = 1 << 22;  // extent is reduced (around 0°N 0°E) for finer grids
+    std::uint64_t seed = 0;
+    std::string directory = ".";
+    std::string output;  // standard output if empty
+    std::string filter;  // only run benchmarks whose name contains filter
+    bool scaling = false;  // run thread and grid scaling study instead of benchmarks
+    std::string impactgen = "impactgen";  // executable for scaling study
+    std::string settings;  // settings file for scaling study (generated inputs if empty)
+};
+
+volatile double sink;  // keeps results of micro benchmarks from being optimized away
+
+impactgen::Generator::Parameters generator_parameters(const Options& options, double resolution) {
+    impactgen::Generator::Parameters res;
+    res.resolution = resolution;
+    const auto cells = 180 / resolution * 360 / resolution;
+    if (cells > options.max_cells) {
+        const auto f = std::sqrt(options.max_cells / cells);
+        const auto half_lat = std::max(1.0, std::floor(90 * f / resolution)) * resolution;
+        const auto half_lon = std::max(1.0, std::floor(180 * f / resolution)) * resolution;
+        res.extent = {-half_lat, half_lat, -half_lon, half_lon};
+    }
+    res.region_count = options.region_count;
+    res.timestep_count = options.timestep_count;
+    res.event_count = options.event_count;
+    res.seed = options.seed;
+    return res;
+}
+
+std::string grid_parameters(const impactgen::GeoGrid<double>& grid) {
+    std::ostringstream ss;
+    ss << "\"resolution\":" << grid.lat_abs_stepsize << ",\"lat_count\":" << grid.lat_count << ",\"lon_count\":" << grid.lon_count;
+    return ss.str();
+}
+
+// writes all generated input files and returns their common filename prefix
+std::string write_inputs(const Options& options, const impactgen::Generator& generator, const std::string& name) {
+    std::ostringstream ss;
+    ss << options.directory << "/" << name << "_" << generator.get_grid().lat_abs_stepsize << "_";
+    const auto prefix = ss.str();
+    generator.write_isoraster(prefix + "isoraster.nc");
+    generator.write_proxy(prefix + "proxy.nc");
+    generator.write_flood_fraction(prefix + "flood_fraction.nc");
+    generator.write_temperature(prefix + "temperature.nc");
+    generator.write_tropical_cyclones(prefix + "tropical_cyclones.nc");
+    return prefix;
+}
+
+// impactgen settings for inputs written by write_inputs, with one impact per given impact type
+std::string settings_yaml(const impactgen::Generator& generator, const std::string& prefix, const std::vector<std::string>& impact_types) {
+    const auto isoraster_filename = prefix + "isoraster.nc";
+    std::ostringstream ss;
+    ss << "output:\n  file: " << prefix << "output.nc\n"
+       << "reference: \"" << generator.time_units() << "\"\n"
+       << "combination: max\n"
+       << "regions: {type: netcdf, file: " << isoraster_filename << ", variable: index}\n"
+       << "sectors: {type: netcdf, file: " << isoraster_filename << ", variable: sector}\n"
+       << "impacts:\n";
+    for (const auto& type : impact_types) {
+        ss << "  - type: " << type << "\n"
+           << "    proxy: {file: " << prefix << "proxy.nc, variable: proxy}\n"
+           << "    isoraster: {file: " << isoraster_filename << ", variable: isoraster, index: index}\n";
+        if (type == "flooding") {
+            ss << "    flood_fraction: {file: " << prefix << "flood_fraction.nc, variable: flood_fraction}\n";
+        } else if (type == "heat_labor_productivity") {
+            ss << "    day_temperature: {file: " << prefix << "temperature.nc, variable: temperature, threshold: 25}\n"
+               << "    sectors: {S0: 0.02, S1: 0.01}\n";
+        } else if (type == "tropical_cyclones") {
+            ss << "    wind_speed: {file: " << prefix << "tropical_cyclones.nc, variable: wind}\n"
+               << "    years: {from: " << generator.get_parameters().year_from << ", to: " << generator.get_parameters().year_from << "}\n"
+               << "    realization: 0\n    threshold: 33\n    velocity: 20\n"
+               << "    seasons: {NA: {from: 6, to: 11}}\n"
+               << "    variables:\n      basin: [NA]\n";
+        }
+    }
+    return ss.str();
+}
+
+class Benchmarks {
+  protected:
+    const Options& options;
+    std::vector<std::string> results;  // as JSON objects
+
+    bool enabled(const std::string& name) const { return name.find(options.filter) != std::string::npos; }
+
+    // runs func options.repetitions times and records timing for items processed per run
+    template<typename Function>
+    void measure(const std::string& name, const std::string& parameters, double items, Function&& func) {
+        std::vector<double> seconds;
+        for (std::size_t r = 0; r < std::max<std::size_t>(options.repetitions, 1); ++r) {
+            const auto begin = std::chrono::steady_clock::now();
+            func();
+            seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+        }
+        const auto first = seconds.front();
+        const auto min = *std::min_element(std::begin(seconds), std::end(seconds));
+        const auto max = *std::max_element(std::begin(seconds), std::end(seconds));
+        double mean = 0;
+        for (const auto s : seconds) {
+            mean += s / seconds.size();
+        }
+        std::ostringstream ss;
+        ss << "{\"name\":\"" << name << "\"," << parameters << ",\"repetitions\":" << seconds.size() << ",\"items\":" << items
+           << ",\"seconds\":{\"first\":" << first << ",\"min\":" << min << ",\"mean\":" << mean << ",\"max\":" << max
+           << "},\"items_per_second\":" << items / min << "}";
+        results.push_back(ss.str());
+        std::cerr << name << " (" << parameters << "): " << min << "s\n";
+    }
+
+    static impactgen::GeoGrid<float> to_float(const impactgen::GeoGrid<double>& grid) {
+        impactgen::GeoGrid<float> res;
+        res.lat_min = grid.lat_min;
+        res.lat_max = grid.lat_max;
+        res.lat_stepsize = grid.lat_stepsize;
+        res.lat_abs_stepsize = grid.lat_abs_stepsize;
+        res.lat_count = grid.lat_count;
+        res.lon_min = grid.lon_min;
+        res.lon_max = grid.lon_max;
+        res.lon_stepsize = grid.lon_stepsize;
+        res.lon_abs_stepsize = grid.lon_abs_stepsize;
+        res.lon_count = grid.lon_count;
+        return res;
+    }
+
+    void micro_benchmarks(const impactgen::GeoGrid<double>& generated_grid) {
+        const auto grid = to_float(generated_grid);
+        const auto parameters = grid_parameters(generated_grid);
+        nvector::Vector<float, 2> a(1.0f, grid.lat_count, grid.lon_count);
+        nvector::Vector<float, 2> b(2.0f, grid.lat_count, grid.lon_count);
+        if (enabled("common_grid_view")) {
+            constexpr std::size_t calls = 1000;
+            measure("common_grid_view", parameters, calls, [&]() {
+                for (std::size_t i = 0; i < calls; ++i) {
+                    impactgen::GeoGrid<float> common_grid;
+                    const auto views = impactgen::common_grid_view(common_grid, impactgen::GridView<float>{a, grid}, impactgen::GridView<float>{b, grid});
+                    sink = std::get<0>(views)(0, 0);
+                }
+            });
+        }
+        if (enabled("foreach_view")) {
+            impactgen::GeoGrid<float> common_grid;
+            const auto views = impactgen::common_grid_view(common_grid, impactgen::GridView<float>{a, grid}, impactgen::GridView<float>{b, grid});
+            measure("foreach_view", parameters, grid.size(), [&]() {
+                double sum = 0;
+                nvector::foreach_view(views, [&](std::size_t, std::size_t, float a_v, float b_v) {
+                    sum += a_v * b_v;
+                    return true;
+                });
+                sink = sum;
+            });
+        }
+        if (enabled("expression")) {
+            impactgen::GeoGrid<float> common_grid;
+            const auto views = impactgen::common_grid_view(common_grid, impactgen::GridView<float>{a, grid}, impactgen::GridView<float>{b, grid});
+            nvector::Vector<float, 2> c(0.0f, common_grid.lat_count, common_grid.lon_count);
+            measure("expression", parameters, grid.size(), [&]() {
+                nvector::assign(c, nvector::max(std::get<0>(views) * std::get<1>(views) - 1.0f, 0.0f));
+                sink = c(0, 0);
+            });
+        }
+    }
+
+    void forcing_benchmarks() {
+        std::vector<std::string> sectors;
+        for (std::size_t s = 0; s < 4; ++s) {
+            sectors.push_back("S" + std::to_string(s));
+        }
+        std::vector<std::string> regions;
+        for (std::size_t r = 0; r < options.region_count; ++r) {
+            regions.push_back("R" + std::to_string(r));
+        }
+        const auto parameters = "\"regions\":" + std::to_string(regions.size()) + ",\"sectors\":" + std::to_string(sectors.size());
+        impactgen::AgentForcing forcing(sectors, regions);
+        impactgen::AgentForcing other(sectors, regions);
+        for (std::size_t s = 0; s < sectors.size(); ++s) {
+            for (std::size_t r = 0; r < regions.size(); ++r) {
+                forcing(s, r) = 1 - (s + r) % 7 * 0.1;
+                other(s, r) = 1 - (s + 2 * r) % 5 * 0.1;
+            }
+        }
+        if (enabled("AgentForcing::include")) {
+            constexpr std::size_t calls = 1000;
+            measure("AgentForcing::include", parameters, calls * sectors.size() * regions.size(), [&]() {
+                for (std::size_t i = 0; i < calls; ++i) {
+                    forcing.include(other, impactgen::ForcingCombination::MAX);
+                }
+                sink = forcing(0, 0);
+            });
+        }
+        if (enabled("ForcingSeries::include")) {
+            const impactgen::ReferenceTime reference_time("days since 2000-01-01");
+            impactgen::ForcingSeries<impactgen::AgentForcing> series(forcing, reference_time);
+            impactgen::ForcingSeries<impactgen::AgentForcing> other_series(forcing, reference_time);
+            for (std::size_t t = 0; t < options.timestep_count; ++t) {
+                series.insert_forcing(reference_time.unreference(t)) = forcing;
+                other_series.insert_forcing(reference_time.unreference(t)) = other;
+            }
+            measure("ForcingSeries::include", parameters + ",\"timesteps\":" + std::to_string(options.timestep_count),
+                    options.timestep_count * sectors.size() * regions.size(),
+                    [&]() { series.include(other_series, impactgen::ForcingCombination::MAX); });
+        }
+    }
+
+    void end_to_end_benchmarks(const impactgen::Generator& generator, const std::string& prefix, int threads) {
+        const auto& grid = generator.get_grid();
+        const auto template_func = [](const std::string& key, const std::string& temp) -> std::string {
+            if (key == "basin") {
+                return "NA";
+            }
+            throw std::runtime_error("Variable '" + key + "' not found for '" + temp + "'");
+        };
+        const auto run = [&](const std::string& name, const std::string& type, double items, auto make_impact) {
+            if (!enabled(name)) {
+                return;
+            }
+            std::stringstream ss(settings_yaml(generator, prefix, {type}));
+            const settings::SettingsNode settings(std::make_unique<settings::YAML>(ss));
+            std::ostringstream parameters;
+            parameters << grid_parameters(grid) << ",\"regions\":" << options.region_count << ",\"threads\":" << threads;
+            measure(name, parameters.str(), items, [&]() {
+                impactgen::Output output(settings);
+                output.add_regions(settings["regions"]);
+                output.add_sectors(settings["sectors"]);
+                output.open();
+                const auto impact_node = *std::begin(settings["impacts"].as_sequence());
+                auto impact = make_impact(impact_node, output.prepare_forcing());
+                impact->join(output, template_func);
+            });
+        };
+        const auto cells = static_cast<double>(grid.size());
+        run("Flooding", "flooding", cells * options.timestep_count,
+            [](const settings::SettingsNode& node, impactgen::AgentForcing base) { return std::make_unique<impactgen::Flooding>(node, std::move(base)); });
+        run("HeatLaborProductivity", "heat_labor_productivity", cells * options.timestep_count,
+            [](const settings::SettingsNode& node, impactgen::AgentForcing base) {
+                return std::make_unique<impactgen::HeatLaborProductivity>(node, std::move(base));
+            });
+        run("TropicalCyclones", "tropical_cyclones", cells * options.event_count,
+            [](const settings::SettingsNode& node, impactgen::AgentForcing base) {
+                return std::make_unique<impactgen::TropicalCyclones>(node, std::move(base));
+            });
+    }
+
+  public:
+    explicit Benchmarks(const Options& options_p) : options(options_p) {}
+
+    void run() {
+        forcing_benchmarks();
+        for (const auto resolution : options.resolutions) {
+            const impactgen::Generator generator(generator_parameters(options, resolution));
+            micro_benchmarks(generator.get_grid());
+            if (!enabled("Flooding") && !enabled("HeatLaborProductivity") && !enabled("TropicalCyclones")) {
+                continue;
+            }
+            const auto prefix = write_inputs(options, generator, "bench");
+            for (const auto threads : options.thread_counts) {
+#ifdef _OPENMP
+                omp_set_num_threads(threads);
+#endif
+                end_to_end_benchmarks(generator, prefix, threads);
+            }
+        }
+    }
+
+    void write(std::ostream& out) const {
+        out << "{\"version\":\"" IMPACTGEN_VERSION "\",\"benchmarks\":[";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            out << (i == 0 ? "\n" : ",\n") << results[i];
+        }
+        out << "\n]}\n";
+    }
+};
+
+// Runs whole impactgen runs as child processes for each thread count to measure wall time, CPU time, peak resident set size and bytes
+// read from block devices. If impactgen has been built with IMPACTGEN_PROFILING, its profiling summary (per-phase breakdown and bytes
+// read per file) is included.
+class Scaling {
+  protected:
+    struct Measurement {
+        int threads;
+        double wall_seconds;
+        double cpu_seconds;
+        long max_rss;  // in KiB
+        std::uint64_t block_input_bytes;
+        std::string profile;  // JSON profiling summary if available
+    };
+
+    const Options& options;
+    std::vector<std::string> results;  // as JSON objects
+
+    Measurement run_impactgen(const std::string& settings_filename, const std::string& profile_filename, int threads) const {
+        std::remove(profile_filename.c_str());
+        setenv("OMP_NUM_THREADS", std::to_string(threads).c_str(), 1);
+        const auto log_filename = settings_filename + ".log";
+        const auto begin = std::chrono::steady_clock::now();
+        const auto pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("Cannot start " + options.impactgen);
+        }
+        if (pid == 0) {
+            const auto log = open(log_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (log >= 0) {
+                dup2(log, STDOUT_FILENO);
+                dup2(log, STDERR_FILENO);
+            }
+            execlp(options.impactgen.c_str(), options.impactgen.c_str(), settings_filename.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        int status;
+        rusage usage;
+        if (wait4(pid, &status, 0, &usage) < 0) {
+            throw std::runtime_error("Cannot wait for " + options.impactgen);
+        }
+        Measurement res;
+        res.threads = threads;
+        res.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            throw std::runtime_error(options.impactgen + " failed for " + settings_filename + " (see " + log_filename + ")");
+        }
+        res.cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        res.max_rss = usage.ru_maxrss;
+        res.block_input_bytes = static_cast<std::uint64_t>(usage.ru_inblock) * 512;
+        std::ifstream profile(profile_filename);
+        if (profile) {
+            res.profile.assign(std::istreambuf_iterator<char>(profile), std::istreambuf_iterator<char>());
+            while (!res.profile.empty() && std::isspace(res.profile.back())) {
+                res.profile.pop_back();
+            }
+        }
+        return res;
+    }
+
+    // sums all "bytes_read" entries of a profiling summary
+    static std::uint64_t profiled_bytes_read(const std::string& profile) {
+        static const std::string key = "\"bytes_read\":";
+        std::uint64_t res = 0;
+        for (auto pos = profile.find(key); pos != std::string::npos; pos = profile.find(key, pos + key.size())) {
+            res += std::stoull(profile.substr(pos + key.size()));
+        }
+        return res;
+    }
+
+    // runs settings (given as YAML text) for all thread counts, keeping the fastest of the repetitions for each
+    void sweep(const std::string& name, const std::string& parameters, const std::string& settings) {
+        const auto settings_filename = options.directory + "/scaling_" + std::to_string(results.size()) + ".yml";
+        const auto profile_filename = settings_filename + ".profile.json";
+        {
+            // the summary is always written to profile_filename, also overriding a summary path already given in the settings
+            auto node = YAML::Load(settings);
+            node["profiling"]["summary"] = profile_filename;
+            YAML::Emitter emitter;
+            emitter << node;
+            std::ofstream out(settings_filename);
+            if (!out) {
+                throw std::runtime_error("Cannot open " + settings_filename);
+            }
+            out << emitter.c_str() << "\n";
+        }
+        std::vector<Measurement> measurements;
+        for (const auto threads : options.thread_counts) {
+            Measurement best;
+            for (std::size_t r = 0; r < std::max<std::size_t>(options.repetitions, 1); ++r) {
+                std::cerr << name << ": " << threads << " thread(s), repetition " << r + 1 << std::endl;
+                auto measurement = run_impactgen(settings_filename, profile_filename, threads);
+                if (r == 0 || measurement.wall_seconds < best.wall_seconds) {
+                    best = std::move(measurement);
+                }
+            }
+            measurements.push_back(std::move(best));
+        }
+        const auto& base = measurements.front();
+        std::ostringstream table;
+        table << "\n" << name << " (" << parameters << ")\n"
+              << std::setw(8) << "threads" << std::setw(12) << "wall [s]" << std::setw(12) << "cpu [s]" << std::setw(16) << "peak RSS [MiB]"
+              << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+              << "\n";
+        for (const auto& m : measurements) {
+            const auto speedup = base.wall_seconds / m.wall_seconds;
+            const auto efficiency = speedup * base.threads / m.threads;
+            table << std::setw(8) << m.threads << std::fixed << std::setprecision(3) << std::setw(12) << m.wall_seconds << std::setw(12)
+                  << m.cpu_seconds << std::setprecision(1) << std::setw(16) << m.max_rss / 1024.0 << std::setprecision(2) << std::setw(10)
+                  << speedup << std::setw(12) << efficiency << std::defaultfloat << "\n";
+            std::ostringstream ss;
+            ss << "{\"name\":\"" << name << "\"," << parameters << ",\"threads\":" << m.threads << ",\"repetitions\":" << options.repetitions
+               << ",\"wall_seconds\":" << m.wall_seconds << ",\"cpu_seconds\":" << m.cpu_seconds << ",\"max_rss_bytes\":" << m.max_rss * 1024
+               << ",\"block_input_bytes\":" << m.block_input_bytes << ",\"speedup\":" << speedup << ",\"efficiency\":" << efficiency;
+            if (m.profile.empty()) {
+                ss << ",\"bytes_read\":null,\"profile\":null}";
+            } else {
+                ss << ",\"bytes_read\":" << profiled_bytes_read(m.profile) << ",\"profile\":" << m.profile << "}";
+            }
+            results.push_back(ss.str());
+        }
+        std::cerr << table.str() << std::endl;
+    }
+
+  public:
+    explicit Scaling(const Options& options_p) : options(options_p) {}
+
+    void run() {
+#ifndef _OPENMP
+        std::cerr << "Warning: built without IMPACTGEN_PARALLELIZATION, thread counts will have no effect" << std::endl;
+#endif
+        if (!options.settings.empty()) {
+            std::ifstream settings_file(options.settings);
+            if (!settings_file) {
+                throw std::runtime_error("Cannot open " + options.settings);
+            }
+            sweep("settings", "\"settings\":\"" + options.settings + "\"",
+                  std::string(std::istreambuf_iterator<char>(settings_file), std::istreambuf_iterator<char>()));
+            return;
+        }
+        for (const auto resolution : options.resolutions) {
+            const impactgen::Generator generator(generator_parameters(options, resolution));
+            const auto prefix = write_inputs(options, generator, "scaling");
+            sweep("generated", grid_parameters(generator.get_grid()) + ",\"regions\":" + std::to_string(options.region_count),
+                  settings_yaml(generator, prefix, {"flooding", "heat_labor_productivity", "tropical_cyclones"}));
+        }
+    }
+
+    void write(std::ostream& out) const {
+        out << "{\"version\":\"" IMPACTGEN_VERSION "\",\"scaling\":[";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            out << (i == 0 ? "\n" : ",\n") << results[i];
+        }
+        out << "\n]}\n";
+    }
+};
+
+template<typename T>
+std::vector<T> parse_list(const std::string& s, T (*parse)(const std::string&)) {
+    std::vector<T> res;
+    std::istringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        res.push_back(parse(item));
+    }
+    return res;
+}
+
+// resolution in degrees, optionally given in arc minutes ("5min") or arc seconds ("30sec")
+double parse_resolution(const std::string& s) {
+    std::size_t pos;
+    const auto value = std::stod(s, &pos);
+    const auto unit = s.substr(pos);
+    if (unit.empty() || unit == "deg") {
+        return value;
+    }
+    if (unit == "min") {
+        return value / 60;
+    }
+    if (unit == "sec") {
+        return value / 3600;
+    }
+    throw std::runtime_error("Unknown resolution unit '" + unit + "'");
+}
+
+int parse_int(const std::string& s) { return std::stoi(s); }
+
+void print_usage(const char* program_name) {
+    std::cerr << "ImpactGen benchmarks\n"
+                 "Version: " IMPACTGEN_VERSION
+                 "\n\n"
+                 "Usage:   "
+              << program_name
+              << " [--scaling] [<option>...]\n"
+                 "Modes:\n"
+                 "  (default)             Micro and end-to-end benchmarks\n"
+                 "  --scaling             Thread and grid scaling study running impactgen for each thread count\n"
+                 "Options:\n"
+                 "  --resolutions=<list>  Grid resolutions, in degrees or with unit min/sec (default: 0.5,5min,30sec)\n"
+                 "  --regions=<n>         Number of regions (default: 100)\n"
+                 "  --timesteps=<n>       Number of time steps (default: 30)\n"
+                 "  --events=<n>          Maximum number of tropical cyclone events (default: 10)\n"
+                 "  --threads=<list>      Thread counts for end-to-end benchmarks (default: 1)\n"
+                 "  --repetitions=<n>     Repetitions per benchmark (default: 3)\n"
+                 "  --max-cells=<n>       Maximum number of grid cells, reducing the extent of finer grids (default: 4194304)\n"
+                 "  --seed=<n>            Seed for generated inputs (default: 0)\n"
+                 "  --directory=<path>    Directory for generated inputs and outputs (default: .)\n"
+                 "  --output=<file>       JSON file for results (default: standard output)\n"
+                 "  --filter=<name>       Only run benchmarks whose name contains name\n"
+                 "  --impactgen=<path>    impactgen executable for scaling study (default: next to this executable)\n"
+                 "  --settings=<file>     Settings file for scaling study (default: generated inputs for each resolution)\n"
+                 "  -h, --help            Print this help text"
+              << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    const std::string program_name = argv[0];
+    const auto slash = program_name.rfind('/');
+    if (slash != std::string::npos) {
+        options.impactgen = program_name.substr(0, slash + 1) + "impactgen";
+    }
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            }
+            if (arg == "--scaling") {
+                options.scaling = true;
+                continue;
+            }
+            const auto eq = arg.find('=');
+            if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            const auto key = arg.substr(2, eq - 2);
+            const auto value = arg.substr(eq + 1);
+            if (key == "resolutions") {
+                options.resolutions = parse_list(value, parse_resolution);
+            } else if (key == "regions") {
+                options.region_count = std::stoul(value);
+            } else if (key == "timesteps") {
+                options.timestep_count = std::stoul(value);
+            } else if (key == "events") {
+                options.event_count = std::stoul(value);
+            } else if (key == "threads") {
+                options.thread_counts = parse_list(value, parse_int);
+            } else if (key == "repetitions") {
+                options.repetitions = std::stoul(value);
+            } else if (key == "max-cells") {
+                options.max_cells = std::stoul(value);
+            } else if (key == "seed") {
+                options.seed = std::stoull(value);
+            } else if (key == "directory") {
+                options.directory = value;
+            } else if (key == "output") {
+                options.output = value;
+            } else if (key == "filter") {
+                options.filter = value;
+            } else if (key == "impactgen") {
+                options.impactgen = value;
+            } else if (key == "settings") {
+                options.settings = value;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        const auto write = [&](const auto& study) {
+            if (options.output.empty()) {
+                study.write(std::cout);
+            } else {
+                std::ofstream out(options.output);
+                if (!out) {
+                    throw std::runtime_error("Cannot open " + options.output);
+                }
+                study.write(out);
+            }
+        };
+        if (options.scaling) {
+            Scaling scaling(options);
+            scaling.run();
+            write(scaling);
+        } else {
+            Benchmarks benchmarks(options);
+            benchmarks.run();
+            write(benchmarks);
+        }
+    } catch (std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 255;
+    }
+    return 0;
+}
@@ -34,6 +34,10 @@ class AgentForcing {
     std::shared_ptr<std::unordered_map<std::string, std::size_t>> sectors;
     std::shared_ptr<std::unordered_map<std::string, std::size_t>> regions;
     std::vector<ForcingType> data;
+    std::vector<QuantizedForcingType> quantized_data;
+    bool quantized = false;
+
+    void check_related(const AgentForcing& other) const;
 
   public:
     AgentForcing() = default;
@@ -48,8 +52,17 @@ class AgentForcing {
         return data[sectors->at(sector) * regions->size() + regions->at(region)];
     }
     inline ForcingType& operator()(std::size_t sector, std::size_t region) { return data[sector * regions->size() + region]; }
+    // element access and get_data are only valid for non-quantized forcings
     void include(const AgentForcing& other, ForcingCombination combination);
+    void include(const std::vector<const AgentForcing*>& others, ForcingCombination combination);
+    // set to aggregate over step_count time steps given by operands, missing time steps counting as without impact (i.e. 1)
+    void aggregate(const std::vector<const AgentForcing*>& operands, std::size_t step_count, ForcingAggregation aggregation);
+    void quantize();
+    void dequantize();
+    constexpr bool is_quantized() const { return quantized; }
     constexpr const std::vector<ForcingType>& get_data() const { return data; }
+    constexpr const std::vector<QuantizedForcingType>& get_quantized_data() const { return quantized_data; }
+    std::size_t memory_size() const { return data.capacity() * sizeof(ForcingType) + quantized_data.capacity() * sizeof(QuantizedForcingType); }
 };
 
 }  // namespace impactgen
@@ -0,0 +1,94 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_ARENA_H
+#define IMPACTGEN_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include "MemoryAccounting.h"
+
+namespace impactgen {
+
+// advise the kernel to back the (2 MiB aligned) pages in [data, data + bytes) by transparent huge pages; no-op for small ranges
+void advise_huge_pages(void* data, std::size_t bytes);
+
+// Buffers of an impact reused across its joins (i.e. variable combinations) instead of being allocated anew for each join. Buffers
+// are taken by name and given back when no longer needed; buffers given back are dropped instead under memory pressure (see
+// MemoryAccounting). Newly allocated large buffers are backed by transparent huge pages, if available.
+class Arena {
+  protected:
+    struct Entry {
+        std::shared_ptr<void> buffer;  // std::vector<T> of the type given back with
+        std::size_t bytes;
+    };
+    std::unordered_map<std::string, Entry> entries;  // by name and element type
+    TrackedMemory memory{MemorySubsystem::ARENA};    // of buffers given back
+
+    template<typename T>
+    static std::string key(const std::string& name) {
+        return name + "@" + typeid(T).name();
+    }
+
+  public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // buffer of size elements set to value, using the storage last given back under name if any
+    template<typename T>
+    std::vector<T> take(const std::string& name, std::size_t size, const T& value = T()) {
+        std::vector<T> res;
+        const auto entry = entries.find(key<T>(name));
+        if (entry != std::end(entries)) {
+            res = std::move(*std::static_pointer_cast<std::vector<T>>(entry->second.buffer));
+            memory.set(memory.size() - entry->second.bytes);
+            entries.erase(entry);
+        }
+        if (res.capacity() < size) {
+            // advise before first touching the new storage
+            std::vector<T>().swap(res);
+            res.reserve(size);
+            advise_huge_pages(res.data(), res.capacity() * sizeof(T));
+        }
+        res.assign(size, value);
+        return res;
+    }
+
+    template<typename T>
+    void give_back(const std::string& name, std::vector<T>&& buffer) {
+        const auto bytes = buffer.capacity() * sizeof(T);
+        if (bytes == 0 || MemoryAccounting::instance().under_pressure()) {
+            return;
+        }
+        auto& entry = entries[key<T>(name)];
+        memory.set(memory.size() - entry.bytes + bytes);
+        entry.buffer = std::make_shared<std::vector<T>>(std::move(buffer));
+        entry.bytes = bytes;
+    }
+};
+
+}  // namespace impactgen
+
+#endif
@@ -0,0 +1,167 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_CALENDAR_H
+#define IMPACTGEN_CALENDAR_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace impactgen {
+
+// CF calendars; times are represented as seconds since 1970-01-01 00:00:00 (UTC) in the respective calendar
+enum class Calendar { STANDARD, PROLEPTIC_GREGORIAN, NOLEAP, DAY360 };
+
+namespace calendar {
+
+struct Date {
+    int year;
+    unsigned int month;  // 1..12
+    unsigned int day;    // 1..31
+};
+
+constexpr bool operator<(const Date& lhs, const Date& rhs) {
+    return lhs.year < rhs.year || (lhs.year == rhs.year && (lhs.month < rhs.month || (lhs.month == rhs.month && lhs.day < rhs.day)));
+}
+
+constexpr std::int64_t seconds_per_day = 24 * 60 * 60;
+
+namespace detail {
+
+// day of year for years starting in March (so that leap days are at the end)
+constexpr unsigned int day_of_march_year(unsigned int month, unsigned int day) { return (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1; }
+
+constexpr Date from_march_year(std::int64_t year, unsigned int day_of_year) {
+    const unsigned int mp = (5 * day_of_year + 2) / 153;
+    const unsigned int month = mp < 10 ? mp + 3 : mp - 9;
+    return Date{static_cast<int>(year + (month <= 2 ? 1 : 0)), month, day_of_year - (153 * mp + 2) / 5 + 1};
+}
+
+// following http://howardhinnant.github.io/date_algorithms.html
+constexpr std::int64_t gregorian_days(int y, unsigned int m, unsigned int d) {
+    const std::int64_t year = static_cast<std::int64_t>(y) - (m <= 2 ? 1 : 0);
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const std::int64_t year_of_era = year - era * 400;
+    const std::int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_march_year(m, d);
+    return era * 146097 + day_of_era - 719468;
+}
+
+constexpr Date gregorian_date(std::int64_t days) {
+    days += 719468;
+    const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const std::int64_t day_of_era = days - era * 146097;
+    const std::int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    return from_march_year(year_of_era + era * 400, day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100));
+}
+
+constexpr std::int64_t julian_days_raw(int y, unsigned int m, unsigned int d) {
+    const std::int64_t year = static_cast<std::int64_t>(y) - (m <= 2 ? 1 : 0);
+    const std::int64_t era = (year >= 0 ? year : year - 3) / 4;
+    return era * 1461 + (year - era * 4) * 365 + day_of_march_year(m, d);
+}
+
+// Julian 1582-10-05 (which does not exist in the standard calendar) coincides with Gregorian 1582-10-15
+constexpr std::int64_t julian_offset = julian_days_raw(1582, 10, 5) - gregorian_days(1582, 10, 15);
+
+constexpr std::int64_t julian_days(int y, unsigned int m, unsigned int d) { return julian_days_raw(y, m, d) - julian_offset; }
+
+constexpr Date julian_date(std::int64_t days) {
+    days += julian_offset;
+    const std::int64_t era = (days >= 0 ? days : days - 1460) / 1461;
+    const std::int64_t day_of_era = days - era * 1461;
+    const std::int64_t year_of_era = (day_of_era - day_of_era / 1460) / 365;
+    return from_march_year(year_of_era + era * 4, day_of_era - 365 * year_of_era);
+}
+
+constexpr std::int64_t gregorian_start = gregorian_days(1582, 10, 15);
+
+constexpr unsigned int noleap_cumulative_days[13] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365};
+
+constexpr std::int64_t floor_div(std::int64_t a, std::int64_t b) { return (a >= 0 ? a : a - b + 1) / b; }
+
+}  // namespace detail
+
+// days since 1970-01-01
+constexpr std::int64_t days_from_date(Calendar calendar, int year, unsigned int month, unsigned int day) {
+    switch (calendar) {
+        case Calendar::STANDARD:
+            return Date{year, month, day} < Date{1582, 10, 15} ? detail::julian_days(year, month, day) : detail::gregorian_days(year, month, day);
+        case Calendar::PROLEPTIC_GREGORIAN:
+            return detail::gregorian_days(year, month, day);
+        case Calendar::NOLEAP:
+            return (static_cast<std::int64_t>(year) - 1970) * 365 + detail::noleap_cumulative_days[month - 1] + day - 1;
+        case Calendar::DAY360:
+            return (static_cast<std::int64_t>(year) - 1970) * 360 + (month - 1) * 30 + day - 1;
+    }
+    return 0;
+}
+
+constexpr Date date_from_days(Calendar calendar, std::int64_t days) {
+    switch (calendar) {
+        case Calendar::STANDARD:
+            return days < detail::gregorian_start ? detail::julian_date(days) : detail::gregorian_date(days);
+        case Calendar::PROLEPTIC_GREGORIAN:
+            return detail::gregorian_date(days);
+        case Calendar::NOLEAP: {
+            const auto year = detail::floor_div(days, 365);
+            const auto day_of_year = static_cast<unsigned int>(days - year * 365);
+            unsigned int month = 1;
+            while (detail::noleap_cumulative_days[month] <= day_of_year) {
+                ++month;
+            }
+            return Date{static_cast<int>(year + 1970), month, day_of_year - detail::noleap_cumulative_days[month - 1] + 1};
+        }
+        case Calendar::DAY360: {
+            const auto year = detail::floor_div(days, 360);
+            const auto day_of_year = static_cast<unsigned int>(days - year * 360);
+            return Date{static_cast<int>(year + 1970), day_of_year / 30 + 1, day_of_year % 30 + 1};
+        }
+    }
+    return Date{1970, 1, 1};
+}
+
+constexpr std::time_t to_time(Calendar calendar, const Date& date, int hour = 0, int minute = 0, int second = 0) {
+    return days_from_date(calendar, date.year, date.month, date.day) * seconds_per_day + hour * 60 * 60 + minute * 60 + second;
+}
+
+constexpr Date to_date(Calendar calendar, std::time_t time) { return date_from_days(calendar, detail::floor_div(time, seconds_per_day)); }
+
+// first day of month following the one of date
+constexpr Date next_month(const Date& date) { return date.month == 12 ? Date{date.year + 1, 1, 1} : Date{date.year, date.month + 1, 1}; }
+
+// handling of dates that do not exist in the target calendar of a conversion (e.g. February 29 in noleap or February 30 in standard):
+// map them to the closest earlier valid day of the same month, or drop them
+enum class MissingDates { PREVIOUS_DAY, DROP };
+
+bool exists(Calendar calendar, const Date& date);
+
+// converts time to the same date and time of day in calendar to; dates not existing there are mapped to the closest earlier valid day
+// of the same month (use exists to detect them)
+std::time_t convert(Calendar from, Calendar to, std::time_t time);
+
+Calendar from_name(const std::string& name);
+const char* name(Calendar calendar);
+
+}  // namespace calendar
+
+}  // namespace impactgen
+
+#endif
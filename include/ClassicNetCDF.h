@@ -0,0 +1,231 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_CLASSICNETCDF_H
+#define IMPACTGEN_CLASSICNETCDF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MappedFile.h"
+#include "nvector.h"
+
+namespace impactgen {
+
+namespace detail {
+
+template<std::size_t size>
+struct ByteSwap;
+
+template<>
+struct ByteSwap<1> {
+    static inline std::uint8_t apply(std::uint8_t v) { return v; }
+};
+
+template<>
+struct ByteSwap<2> {
+    static inline std::uint16_t apply(std::uint16_t v) { return __builtin_bswap16(v); }
+};
+
+template<>
+struct ByteSwap<4> {
+    static inline std::uint32_t apply(std::uint32_t v) { return __builtin_bswap32(v); }
+};
+
+template<>
+struct ByteSwap<8> {
+    static inline std::uint64_t apply(std::uint64_t v) { return __builtin_bswap64(v); }
+};
+
+template<typename T>
+inline T from_big_endian(const char* data) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    typename std::conditional<
+        sizeof(T) == 1, std::uint8_t,
+        typename std::conditional<sizeof(T) == 2, std::uint16_t, typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type>::type>::type
+        raw;
+    std::memcpy(&raw, data, sizeof(T));
+    raw = ByteSwap<sizeof(T)>::apply(raw);
+    T res;
+    std::memcpy(&res, &raw, sizeof(T));
+    return res;
+#else
+    T res;
+    std::memcpy(&res, data, sizeof(T));
+    return res;
+#endif
+}
+
+}  // namespace detail
+
+// Random-access iterator over big-endian values as stored in netCDF classic files, decoding on access (to be used with nvector::View
+// with T as reference type, so that the byte swap happens right in the kernel iterating over the view)
+template<typename T>
+class BigEndianIterator {
+  protected:
+    const char* data_m = nullptr;
+
+  public:
+    using value_type = T;
+
+    BigEndianIterator() = default;
+    explicit BigEndianIterator(const char* data_p) : data_m(data_p) {}
+    inline T operator[](std::size_t index) const {
+        // index may have wrapped around for negative strides as used by GeoGrid::box
+        return detail::from_big_endian<T>(data_m + static_cast<std::ptrdiff_t>(index) * static_cast<std::ptrdiff_t>(sizeof(T)));
+    }
+    inline T operator*() const { return detail::from_big_endian<T>(data_m); }
+    inline BigEndianIterator operator+(std::size_t index) const {
+        return BigEndianIterator(data_m + static_cast<std::ptrdiff_t>(index) * static_cast<std::ptrdiff_t>(sizeof(T)));
+    }
+    inline const char* data() const { return data_m; }
+};
+
+template<typename T, std::size_t dim>
+using BigEndianView = nvector::View<T, dim, BigEndianIterator<T>, T>;
+
+// Minimal reader for uncompressed netCDF files in classic (CDF-1), 64-bit offset (CDF-2) and 64-bit data (CDF-5) format. The file
+// is memory-mapped (or already in memory) and variables are accessed in place without going through the netCDF library (and hence its
+// global lock).
+class ClassicNetCDF {
+  public:
+    enum class Type { BYTE = 1, CHAR = 2, SHORT = 3, INT = 4, FLOAT = 5, DOUBLE = 6, UBYTE = 7, USHORT = 8, UINT = 9, INT64 = 10, UINT64 = 11 };
+
+    struct Dimension {
+        std::string name;
+        std::size_t size;  // 0 for record dimension
+    };
+
+    struct Attribute {
+        std::string name;
+        Type type;
+        std::size_t count;
+        const char* data;
+    };
+
+    struct Variable {
+        std::string name;
+        std::vector<std::size_t> dimensions;  // indices into dimensions of file
+        std::vector<Attribute> attributes;
+        Type type;
+        std::size_t size;  // in bytes (of one record for record variables)
+        std::uint64_t begin;
+        bool is_record;
+    };
+
+    template<typename T>
+    struct type_of;
+
+  protected:
+    std::string filename;
+    std::unique_ptr<MappedFile> file;  // null if reading from memory not owned by this
+    const char* data;
+    std::size_t size;
+    int format;  // 1, 2, or 5
+    std::size_t record_count_m = 0;
+    std::size_t record_size = 0;
+    std::vector<Dimension> dimensions_m;
+    std::vector<Attribute> attributes_m;
+    std::vector<Variable> variables_m;
+
+    struct Parser;
+    void parse();
+    const char* element_data(const Variable& variable, const std::vector<std::size_t>& indices) const;
+
+  public:
+    static bool is_classic(const std::string& filename);
+    static bool is_classic(const char* data_p, std::size_t size_p);
+    static std::size_t type_size(Type type);
+
+    explicit ClassicNetCDF(std::string filename_p);
+    ClassicNetCDF(std::string filename_p, const char* data_p, std::size_t size_p);  // data needs to be kept available
+    std::size_t record_count() const { return record_count_m; }
+    const std::vector<Dimension>& dimensions() const { return dimensions_m; }
+    const std::vector<Variable>& variables() const { return variables_m; }
+    const Variable* variable(const std::string& name) const;
+    std::size_t dimension_size(const Variable& variable, std::size_t i) const;
+
+    // sizes of the innermost two dimensions of a variable; for one outer index less, the innermost dimension (e.g. of gathered values)
+    // is regarded as a single row
+    void slice_dimensions(const Variable& variable, const std::vector<std::size_t>& outer_indices, std::size_t& lat_size, std::size_t& lon_size) const;
+
+    // view of (a rectangular part of) the innermost two dimensions of a variable at the given indices of the outer dimensions
+    template<typename T>
+    BigEndianView<T, 2> slice(const Variable& variable,
+                              const std::vector<std::size_t>& outer_indices,
+                              std::size_t lat_begin = 0,
+                              std::size_t lat_count = 0,  // 0 for all
+                              std::size_t lon_begin = 0,
+                              std::size_t lon_count = 0  // 0 for all
+    ) const {
+        if (variable.type != type_of<T>::value) {
+            throw std::runtime_error(filename + " - " + variable.name + ": Unexpected type");
+        }
+        std::size_t lat_size;
+        std::size_t lon_size;
+        slice_dimensions(variable, outer_indices, lat_size, lon_size);
+        if (lat_count == 0) {
+            lat_count = lat_size - lat_begin;
+        }
+        if (lon_count == 0) {
+            lon_count = lon_size - lon_begin;
+        }
+        if (lat_begin + lat_count > lat_size || lon_begin + lon_count > lon_size) {
+            throw std::runtime_error(filename + " - " + variable.name + ": Index out of bounds");
+        }
+        return BigEndianView<T, 2>(BigEndianIterator<T>(element_data(variable, outer_indices)),
+                                   {nvector::Slice{static_cast<int>(lat_begin), lat_count, static_cast<int>(lon_size)},
+                                    nvector::Slice{static_cast<int>(lon_begin), lon_count, 1}});
+    }
+
+    // copies (a rectangular part of) the innermost two dimensions of a variable at the given indices of the outer dimensions to out
+    // (lat_count * lon_count values of the variable's type), converting to native byte order
+    void read_slice(const Variable& variable,
+                    const std::vector<std::size_t>& outer_indices,
+                    std::size_t lat_begin,
+                    std::size_t lat_count,
+                    std::size_t lon_begin,
+                    std::size_t lon_count,
+                    char* out) const;
+};
+
+template<>
+struct ClassicNetCDF::type_of<float> {
+    static constexpr Type value = Type::FLOAT;
+};
+
+template<>
+struct ClassicNetCDF::type_of<double> {
+    static constexpr Type value = Type::DOUBLE;
+};
+
+template<>
+struct ClassicNetCDF::type_of<int> {
+    static constexpr Type value = Type::INT;
+};
+
+}  // namespace impactgen
+
+#endif
@@ -0,0 +1,113 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_DISKCACHE_H
+#define IMPACTGEN_DISKCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MappedStorage.h"
+
+namespace impactgen {
+
+std::uint64_t fnv1a_hash(const char* data, std::size_t size, std::uint64_t hash = 14695981039346656037ULL);
+
+// On-disk cache of data derived from (static) input files, so that later runs can skip reading and decoding them. Each cache file
+// holds a versioned header, the full source filename and key it was stored for (files are named by their hash only) and raw arrays
+// ("sections") at aligned offsets. It is only used if size and modification time (and, optionally, content hash) of the source file
+// still match. Failing to write a cache file only gives a warning. Cache files are mapped copy-on-write, so that sections can be used in
+// place (see Entry::storage) without ever modifying the file.
+class DiskCache {
+  public:
+    static constexpr std::uint32_t version = 2;
+    static constexpr std::size_t alignment = 64;
+    static constexpr std::size_t max_sections = 8;
+
+    struct Section {
+        const void* data;
+        std::size_t size;  // in bytes
+    };
+
+    class Entry {
+        friend class DiskCache;
+
+      protected:
+        std::shared_ptr<const MappedFile> file;
+        std::vector<Section> sections;
+
+      public:
+        std::size_t section_count() const { return sections.size(); }
+        template<typename T>
+        const T* section(std::size_t index, std::size_t& count) const {
+            const auto& s = sections.at(index);
+            count = s.size / sizeof(T);
+            return static_cast<const T*>(s.data);
+        }
+        // section elements used in place, keeping the mapping alive as long as needed
+        template<typename T>
+        MappedStorage<T> storage(std::size_t index) const {
+            const auto& s = sections.at(index);
+            const auto offset = static_cast<const char*>(s.data) - file->data();
+            return MappedStorage<T>(file, reinterpret_cast<T*>(file->writable_data() + offset), s.size / sizeof(T));
+        }
+    };
+
+  protected:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t key_hash;
+        std::uint64_t identity_size;  // size of source filename and key following the header
+        std::uint64_t source_size;
+        std::int64_t source_mtime;
+        std::uint64_t source_hash;  // 0 if not verified
+        std::uint64_t section_count;
+        std::uint64_t section_offsets[max_sections];
+        std::uint64_t section_sizes[max_sections];
+    };
+
+    std::string directory;
+    bool verify_hash = false;
+
+    DiskCache() = default;
+    std::string cache_filename(std::uint64_t key_hash) const;
+    static std::string identity(const std::string& source_filename, const std::string& key);
+    bool fill_source_info(const std::string& source_filename, Header& header) const;
+
+  public:
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+    static DiskCache& instance();
+    void set_directory(std::string directory_p, bool verify_hash_p);
+    bool enabled() const { return !directory.empty(); }
+    const std::string& get_directory() const { return directory; }
+    std::unique_ptr<Entry> load(const std::string& source_filename, const std::string& key) const;
+    void store(const std::string& source_filename, const std::string& key, const std::vector<Section>& sections) const;
+};
+
+}  // namespace impactgen
+
+#endif
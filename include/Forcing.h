@@ -21,7 +21,11 @@
 #ifndef IMPACTGEN_FORCING_H
 #define IMPACTGEN_FORCING_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
+#include <limits>
 #include <unordered_map>
 #include "helpers.h"
 
@@ -29,8 +33,119 @@ namespace impactgen {
 
 enum class ForcingCombination { ADD, MAX, MIN, MULT };
 
+enum class ForcingAggregation { MEAN, MIN, MAX, PRODUCT };
+
 using ForcingType = float;
 
+// larger input values (as well as NaN) denote missing data; check as !(v <= max_valid_forcing) to cover both at once
+constexpr ForcingType max_valid_forcing = 1e10;
+
+// fixed-point representation of forcing values in [0, 1]
+using QuantizedForcingType = std::uint16_t;
+
+namespace quantization {
+
+// values in [0, 1] are encoded as 0..max_value; the largest representable value (which is also the netCDF default fill value for
+// unsigned shorts) denotes missing data (NaN), so that "no impact" (1.0) is not masked by readers
+constexpr QuantizedForcingType fill_value = std::numeric_limits<QuantizedForcingType>::max();
+constexpr QuantizedForcingType max_value = fill_value - 1;
+constexpr ForcingType scale_factor = ForcingType(1.0) / max_value;
+
+// result of combining a and b, missing if either of them is missing (kept as select so that loops still get vectorized)
+inline QuantizedForcingType propagate_missing(QuantizedForcingType a, QuantizedForcingType b, QuantizedForcingType res) {
+    return a == fill_value || b == fill_value ? fill_value : res;
+}
+
+void encode(const ForcingType* in, QuantizedForcingType* out, std::size_t size);
+void decode(const QuantizedForcingType* in, ForcingType* out, std::size_t size);
+
+}  // namespace quantization
+
+// element-wise combination of two forcing values (specialized for each combination and representation)
+template<ForcingCombination combination, typename T>
+struct Combiner;
+
+template<>
+struct Combiner<ForcingCombination::ADD, ForcingType> {
+    static inline ForcingType apply(ForcingType a, ForcingType b) { return std::max(a + b - ForcingType(1.0), ForcingType(0.0)); }
+};
+
+template<>
+struct Combiner<ForcingCombination::MAX, ForcingType> {
+    static inline ForcingType apply(ForcingType a, ForcingType b) { return std::max(a, b); }
+};
+
+template<>
+struct Combiner<ForcingCombination::MIN, ForcingType> {
+    static inline ForcingType apply(ForcingType a, ForcingType b) { return std::min(a, b); }
+};
+
+template<>
+struct Combiner<ForcingCombination::MULT, ForcingType> {
+    static inline ForcingType apply(ForcingType a, ForcingType b) { return a * b; }
+};
+
+template<>
+struct Combiner<ForcingCombination::ADD, QuantizedForcingType> {
+    // max(a + b - 1, 0) in fixed-point
+    static inline QuantizedForcingType apply(QuantizedForcingType a, QuantizedForcingType b) {
+        return quantization::propagate_missing(
+            a, b, static_cast<QuantizedForcingType>(std::max(std::int32_t(a) + std::int32_t(b) - std::int32_t(quantization::max_value), std::int32_t(0))));
+    }
+};
+
+template<>
+struct Combiner<ForcingCombination::MAX, QuantizedForcingType> {
+    static inline QuantizedForcingType apply(QuantizedForcingType a, QuantizedForcingType b) { return quantization::propagate_missing(a, b, std::max(a, b)); }
+};
+
+template<>
+struct Combiner<ForcingCombination::MIN, QuantizedForcingType> {
+    static inline QuantizedForcingType apply(QuantizedForcingType a, QuantizedForcingType b) { return quantization::propagate_missing(a, b, std::min(a, b)); }
+};
+
+template<>
+struct Combiner<ForcingCombination::MULT, QuantizedForcingType> {
+    // a * b in fixed-point, rounded to nearest
+    static inline QuantizedForcingType apply(QuantizedForcingType a, QuantizedForcingType b) {
+        return quantization::propagate_missing(
+            a, b, static_cast<QuantizedForcingType>((std::uint32_t(a) * std::uint32_t(b) + quantization::max_value / 2) / quantization::max_value));
+    }
+};
+
+// fold all operands into data; blockwise, so that each block of data stays in cache while all operands are combined into it
+template<ForcingCombination combination, typename T>
+void combine(T* data, const T* const* others, std::size_t count, std::size_t size) {
+    constexpr std::size_t block_size = 4096;
+    for (std::size_t begin = 0; begin < size; begin += block_size) {
+        const auto end = std::min(begin + block_size, size);
+        for (std::size_t k = 0; k < count; ++k) {
+            const T* other = others[k];
+            for (std::size_t i = begin; i < end; ++i) {
+                data[i] = Combiner<combination, T>::apply(data[i], other[i]);
+            }
+        }
+    }
+}
+
+template<typename T>
+void combine(T* data, const T* const* others, std::size_t count, std::size_t size, ForcingCombination combination) {
+    switch (combination) {
+        case ForcingCombination::ADD:
+            combine<ForcingCombination::ADD>(data, others, count, size);
+            break;
+        case ForcingCombination::MAX:
+            combine<ForcingCombination::MAX>(data, others, count, size);
+            break;
+        case ForcingCombination::MIN:
+            combine<ForcingCombination::MIN>(data, others, count, size);
+            break;
+        case ForcingCombination::MULT:
+            combine<ForcingCombination::MULT>(data, others, count, size);
+            break;
+    }
+}
+
 }  // namespace impactgen
 
 #endif
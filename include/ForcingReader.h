@@ -0,0 +1,185 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_FORCINGREADER_H
+#define IMPACTGEN_FORCINGREADER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "ClassicNetCDF.h"
+#include "Forcing.h"
+#include "GeoGrid.h"
+#include "InputFile.h"
+#include "MemoryAccounting.h"
+#include "Metrics.h"
+#include "Packing.h"
+#include "Profiling.h"
+#include "netcdftools.h"
+#include "nvector.h"
+
+namespace impactgen {
+
+// Reads consecutive two-dimensional (lat/lon) slices of a forcing variable, optionally restricted to a rectangular part of the
+// lat/lon grid. For uncompressed classic-format files the slices are accessed in place in the memory-mapped file, otherwise they are
+// read chunk-wise through the netCDF library. Packed variables (or ones with missing values not recognized as invalid by the kernels)
+// are read in their own type and unpacked to ForcingType with missing values set to NaN. Slices of variables not stored in canonical
+// layout (see GeoGrid) are read as up to two contiguous hyperslabs (split where a global grid is rotated) and brought into canonical
+// layout in the chunk buffer. Under memory pressure (see MemoryAccounting), fewer slices are read per chunk. If an arena is given,
+// the buffers are taken from it and given back when the reader is destroyed.
+class ForcingReader {
+  protected:
+    std::string filename;
+    netCDF::NcVar variable;
+    std::size_t lat_begin;
+    std::size_t lat_count;
+    std::size_t lon_begin;
+    std::size_t lon_count;
+    bool gathered = false;  // slices are (part of) the innermost dimension only, regarded as a single row
+    std::size_t chunk_size;
+    Packing packing;
+    std::vector<ForcingType> chunk_buffer;
+    std::vector<std::uint64_t> raw_buffer;  // uint64_t for alignment of all raw types
+    TrackedMemory buffer_memory{MemorySubsystem::CHUNK_BUFFERS};
+    Arena* arena = nullptr;
+    std::unique_ptr<ClassicNetCDF> classic_file;
+    const ClassicNetCDF::Variable* classic_variable = nullptr;
+
+    // contiguous range of stored columns and the (canonical) column of the part read it is placed at
+    struct Segment {
+        std::size_t stored_begin;
+        std::size_t count;
+        std::size_t offset;
+    };
+    bool remapped = false;  // not stored in canonical layout
+    bool lat_reversed = false;
+    bool lon_reversed = false;
+    std::size_t stored_lat_begin = 0;
+    std::vector<Segment> lon_segments;
+    std::vector<ForcingType> segment_buffer;
+
+    void open(const InputFile& file);
+    void read_remapped(const std::vector<std::size_t>& outer_indices, std::size_t first_index, std::size_t chunk_count);
+    nvector::View<ForcingType, 2> buffer_view(std::size_t chunk_pos) {
+        return nvector::View<ForcingType, 2>(std::begin(chunk_buffer) + chunk_pos * lat_count * lon_count,
+                                             {nvector::Slice{0, lat_count, static_cast<int>(lon_count)}, nvector::Slice{0, lon_count, 1}});
+    }
+
+  public:
+    // read_grid describes the part of grid to be read, starting at (canonical) indices lat_begin_p and lon_begin_p
+    ForcingReader(const InputFile& file,
+                  const netCDF::NcVar& variable_p,
+                  const GeoGrid<float>& grid,
+                  std::size_t chunk_size_p,
+                  const GeoGrid<float>& read_grid,
+                  std::size_t lat_begin_p,
+                  std::size_t lon_begin_p,
+                  Arena* arena_p = nullptr);
+    // reads the whole grid
+    ForcingReader(const InputFile& file, const netCDF::NcVar& variable_p, const GeoGrid<float>& grid, std::size_t chunk_size_p, Arena* arena_p = nullptr)
+        : ForcingReader(file, variable_p, grid, chunk_size_p, grid, 0, 0, arena_p) {}
+    // for gathered (land-only) variables, reads positions [begin, begin + count) along the innermost dimension
+    ForcingReader(const InputFile& file,
+                  const netCDF::NcVar& variable_p,
+                  std::size_t begin,
+                  std::size_t count,
+                  std::size_t chunk_size_p,
+                  Arena* arena_p = nullptr);
+    ForcingReader(ForcingReader&&) = default;
+    ~ForcingReader();
+    bool is_mapped() const { return classic_variable != nullptr; }
+
+    // calls func(index, view) for the slices at {outer_indices..., offset + index} for index in [0, count), view being an
+    // nvector::View of ForcingType (its iterator type differs between the two ways of reading)
+    template<typename Function>
+    void foreach_slice(const std::vector<std::size_t>& outer_indices, std::size_t offset, std::size_t count, Function&& func) {
+        if (remapped) {
+            for (std::size_t index = 0; index < count; index += chunk_size) {
+                const auto chunk_count = std::min(chunk_size, count - index);
+                read_remapped(outer_indices, offset + index, chunk_count);
+                for (std::size_t chunk_pos = 0; chunk_pos < chunk_count; ++chunk_pos) {
+                    IMPACTGEN_PROFILE("kernel");
+                    func(index + chunk_pos, buffer_view(chunk_pos));
+                }
+            }
+            return;
+        }
+        std::vector<std::size_t> indices(outer_indices);
+        indices.push_back(0);
+        if (classic_variable) {
+            for (std::size_t index = 0; index < count; ++index) {
+                indices.back() = offset + index;
+                IMPACTGEN_PROFILE_BYTES(filename, lat_count * lon_count * packing.raw_size());
+                Metrics::instance().add_read(lat_count * lon_count, lat_count * lon_count * packing.raw_size());
+                if (packing.is_trivial()) {
+                    const auto view = classic_file->slice<ForcingType>(*classic_variable, indices, lat_begin, lat_count, lon_begin, lon_count);
+                    IMPACTGEN_PROFILE("kernel");
+                    func(index, view);
+                } else {
+                    {
+                        IMPACTGEN_PROFILE("read");
+                        classic_file->read_slice(*classic_variable, indices, lat_begin, lat_count, lon_begin, lon_count,
+                                                 reinterpret_cast<char*>(&raw_buffer[0]));
+                        packing.unpack(&raw_buffer[0], &chunk_buffer[0], lat_count * lon_count);
+                    }
+                    IMPACTGEN_PROFILE("kernel");
+                    func(index, buffer_view(0));
+                }
+            }
+            return;
+        }
+        std::vector<std::size_t> counts(outer_indices.size(), 1);
+        counts.push_back(0);
+        if (!gathered) {
+            counts.push_back(lat_count);
+            indices.push_back(lat_begin);
+        }
+        counts.push_back(lon_count);
+        indices.push_back(lon_begin);
+        for (std::size_t index = 0; index < count; index += chunk_size) {
+            const auto chunk_count = std::min(chunk_size, count - index);
+            indices[outer_indices.size()] = offset + index;
+            counts[outer_indices.size()] = chunk_count;
+            {
+                IMPACTGEN_PROFILE("read");
+                IMPACTGEN_PROFILE_BYTES(filename, chunk_count * lat_count * lon_count * packing.raw_size());
+                Metrics::instance().add_read(chunk_count * lat_count * lon_count, chunk_count * lat_count * lon_count * packing.raw_size());
+                if (packing.is_trivial()) {
+                    variable.getVar(indices, counts, &chunk_buffer[0]);
+                } else {
+                    variable.getVar(indices, counts, static_cast<void*>(&raw_buffer[0]));  // in the variable's own type
+                    packing.unpack(&raw_buffer[0], &chunk_buffer[0], chunk_count * lat_count * lon_count);
+                }
+            }
+            for (std::size_t chunk_pos = 0; chunk_pos < chunk_count; ++chunk_pos) {
+                IMPACTGEN_PROFILE("kernel");
+                func(index + chunk_pos, buffer_view(chunk_pos));
+            }
+        }
+    }
+};
+
+}  // namespace impactgen
+
+#endif
@@ -23,31 +23,97 @@
 
 #include <algorithm>
 #include <ctime>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
 #include "Forcing.h"
+#include "MemoryAccounting.h"
+#include "Profiling.h"
 #include "ReferenceTime.h"
 
 namespace impactgen {
 
+// Forcings of series no longer needed, reused for new time steps instead of allocating new ones (copy assignment of the base forcing
+// keeps their storage). Forcings are dropped instead under memory pressure (see MemoryAccounting)
+template<class Forcing>
+class ForcingPool {
+  protected:
+    std::mutex mutex;
+    std::vector<Forcing> forcings;
+    TrackedMemory memory{MemorySubsystem::ARENA};
+
+  public:
+    // copy of base
+    Forcing take(const Forcing& base) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (forcings.empty()) {
+            lock.unlock();
+            return Forcing(base);
+        }
+        Forcing res = std::move(forcings.back());
+        forcings.pop_back();
+        memory.set(memory.size() - res.memory_size());
+        lock.unlock();
+        res = base;
+        return res;
+    }
+
+    void give_back(Forcing&& forcing) {
+        const auto bytes = forcing.memory_size();
+        if (bytes == 0 || MemoryAccounting::instance().under_pressure()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        memory.set(memory.size() + bytes);
+        forcings.emplace_back(std::move(forcing));
+    }
+};
+
 template<class Forcing>
 class ForcingSeries {
   protected:
     std::unordered_map<int, Forcing> data;
+    std::shared_ptr<ForcingPool<Forcing>> pool;  // to take new and give back dropped forcings, if set
+    bool quantized = false;  // store forcings in fixed-point representation (except for those modified in place)
+    TrackedMemory memory{MemorySubsystem::FORCING_SERIES};
+
+    void store(Forcing& forcing) const {
+        if (quantized) {
+            forcing.quantize();
+        }
+    }
+
+    void account_inserted(const Forcing& forcing) { memory.set(memory.size() + forcing.memory_size()); }
+    void account() { memory.set(memory_size()); }
 
   public:
     const ReferenceTime reference_time;
     const Forcing base_forcing;
     ForcingSeries() = default;
-    ForcingSeries(Forcing base_forcing_p, ReferenceTime reference_time_p) : base_forcing(std::move(base_forcing_p)), reference_time(reference_time_p) {}
+    ForcingSeries(Forcing base_forcing_p, ReferenceTime reference_time_p, bool quantized_p = false)
+        : quantized(quantized_p), reference_time(reference_time_p), base_forcing(std::move(base_forcing_p)) {}
+    ForcingSeries(const ForcingSeries&) = default;
+    ForcingSeries(ForcingSeries&&) = default;
+    ~ForcingSeries() {
+        if (pool) {
+            for (auto& d : data) {
+                pool->give_back(std::move(d.second));
+            }
+        }
+    }
+
+    void set_pool(std::shared_ptr<ForcingPool<Forcing>> pool_p) { pool = std::move(pool_p); }
 
     Forcing& insert_forcing(std::time_t time) {
         const auto t = reference_time.reference(time);
         if (data.find(t) != std::end(data)) {
             throw std::runtime_error("Time already set");
         }
-        return data.emplace(t, Forcing(base_forcing)).first->second;
+        auto& res = data.emplace(t, pool ? pool->take(base_forcing) : Forcing(base_forcing)).first->second;
+        account_inserted(res);
+        return res;
     }
 
     void insert_forcing(std::time_t time, Forcing forcing) {
@@ -55,7 +121,9 @@ class ForcingSeries {
         if (data.find(t) != std::end(data)) {
             throw std::runtime_error("Time already set");
         }
-        data.emplace(t, forcing);
+        store(forcing);
+        account_inserted(forcing);
+        data.emplace(t, std::move(forcing));
     }
 
     void insert_forcing(std::time_t time, Forcing forcing, ForcingCombination combination) {
@@ -63,13 +131,44 @@ class ForcingSeries {
         auto f = data.find(t);
         if (f != std::end(data)) {
             f->second.include(forcing, combination);
+            if (pool) {
+                pool->give_back(std::move(forcing));
+            }
         } else {
-            data.emplace(t, forcing);
+            store(forcing);
+            account_inserted(forcing);
+            data.emplace(t, std::move(forcing));
         }
     }
 
     Forcing& get_forcing(std::time_t time) { return data.at(reference_time.reference(time)); }
 
+    template<typename Function>
+    void foreach_forcing(Function&& func) const {
+        for (const auto& d : data) {
+            func(reference_time.unreference(d.first), d.second);
+        }
+    }
+
+    void quantize() {
+        quantized = true;
+        for (auto& d : data) {
+            d.second.quantize();
+        }
+        account();
+    }
+
+    // subsystem the memory of this series is accounted to (FORCING_SERIES by default)
+    void set_memory_subsystem(MemorySubsystem subsystem) { memory.set_subsystem(subsystem); }
+
+    std::size_t memory_size() const {
+        std::size_t res = 0;
+        for (const auto& forcing : data) {
+            res += forcing.second.memory_size();
+        }
+        return res;
+    }
+
     std::vector<std::time_t> get_sorted_times() const {
         std::vector<std::time_t> res(data.size());
         int i = 0;
@@ -82,18 +181,49 @@ class ForcingSeries {
     }
 
     void include(const ForcingSeries<Forcing>& other, ForcingCombination combination) {
+        IMPACTGEN_PROFILE("forcing_series_include");
         if (!reference_time.compatible_with(other.reference_time)) {
-            throw std::runtime_error("Incompatible accuracies");
+            throw std::runtime_error("Incompatible accuracies or calendars");
         }
         for (const auto& other_forcing : other.data) {
             const auto t = reference_time.reference(other.reference_time.unreference(other_forcing.first));
             auto forcing = data.find(t);
             if (forcing == std::end(data)) {
-                data[t] = other_forcing.second;
+                auto& new_forcing = data[t] = other_forcing.second;
+                store(new_forcing);
             } else {
                 forcing->second.include(other_forcing.second, combination);
             }
         }
+        account();
+    }
+
+    // merge many series at once, folding all operands of a time step into it in one pass
+    void include(const std::vector<const ForcingSeries<Forcing>*>& others, ForcingCombination combination) {
+        IMPACTGEN_PROFILE("forcing_series_include");
+        std::unordered_map<int, std::vector<const Forcing*>> operands;
+        for (const auto other : others) {
+            if (!reference_time.compatible_with(other->reference_time)) {
+                throw std::runtime_error("Incompatible accuracies or calendars");
+            }
+            for (const auto& other_forcing : other->data) {
+                operands[reference_time.reference(other->reference_time.unreference(other_forcing.first))].push_back(&other_forcing.second);
+            }
+        }
+        for (auto& t_operands : operands) {
+            auto forcing = data.find(t_operands.first);
+            if (forcing == std::end(data)) {
+                auto& new_forcing = data[t_operands.first] = *t_operands.second.front();
+                t_operands.second.erase(std::begin(t_operands.second));
+                if (!t_operands.second.empty()) {
+                    new_forcing.include(t_operands.second, combination);
+                }
+                store(new_forcing);
+            } else {
+                forcing->second.include(t_operands.second, combination);
+            }
+        }
+        account();
     }
 };
 
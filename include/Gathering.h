@@ -0,0 +1,71 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_GATHERING_H
+#define IMPACTGEN_GATHERING_H
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GeoGrid.h"
+#include "netcdftools.h"
+
+namespace impactgen {
+
+// Checks whether the innermost dimension of variable is "compressed by gathering" (CF conventions, section 8.2), as used for land-only
+// files: its coordinate variable has a "compress" attribute naming the latitude and longitude dimensions and lists the indices of the
+// given cells in the flattened lat/lon grid. If so, these are read into indices (after checking them against grid) and true is returned.
+bool read_gathering(const netCDF::NcGroup& file,
+                    const netCDF::NcVar& variable,
+                    const GeoGrid<float>& grid,
+                    const std::string& filename,
+                    std::vector<std::size_t>& indices);
+
+// Cells of a grid in either full layout (positions being the flattened canonical lat/lon indices, see GeoGrid) or gathered layout
+// (positions along the gathered dimension, see read_gathering, whose indices refer to the layout as stored)
+class GridCells {
+  protected:
+    const GeoGrid<float>& grid;
+    const std::vector<std::size_t>& gathered;
+    std::unordered_map<std::size_t, std::size_t> positions;  // flattened index -> position, only for gathered layout
+
+  public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    GridCells(const GeoGrid<float>& grid_p, const std::vector<std::size_t>& gathered_p);
+    const GeoGrid<float>& get_grid() const { return grid; }
+    std::size_t size() const { return gathered.empty() ? grid.size() : gathered.size(); }
+    // flattened canonical lat/lon index
+    std::size_t flat_index(std::size_t position) const {
+        return gathered.empty() ? position
+                                : grid.canonical_lat_index(gathered[position] / grid.lon_count) * grid.lon_count
+                                      + grid.canonical_lon_index(gathered[position] % grid.lon_count);
+    }
+    float lat(std::size_t position) const { return grid.lat(flat_index(position) / grid.lon_count); }
+    float lon(std::size_t position) const { return grid.lon(flat_index(position) % grid.lon_count); }
+    // position of the cell closest to the given coordinates, npos if outside of grid or not given
+    std::size_t find(float lat, float lon) const;
+};
+
+}  // namespace impactgen
+
+#endif
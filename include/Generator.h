@@ -0,0 +1,96 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_GENERATOR_H
+#define IMPACTGEN_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Forcing.h"
+#include "GeoGrid.h"
+#include "netcdftools.h"
+
+namespace impactgen {
+
+// Writes synthetic input files of configurable size in the layouts expected by the readers, for benchmarks and performance tests.
+// Values are pseudo-random, but only depend on the seed and their position (not on the order of writing), so that files are
+// reproducible.
+class Generator {
+  public:
+    struct Parameters {
+        double resolution = 0.5;  // in degrees
+        GeoBox<double> extent = {-90, 90, -180, 180};
+        std::size_t region_count = 100;
+        std::size_t sector_count = 4;
+        std::size_t timestep_count = 365;  // daily, starting at year_from
+        std::size_t realization_count = 1;
+        std::size_t year_count = 1;
+        std::size_t event_count = 10;  // maximum number of tropical cyclone events per realization and year
+        int year_from = 2000;
+        double land_fraction = 1;  // approximate share of land cells, all other cells are ocean with missing values
+        int compression_level = 0;  // deflate level (0 for no compression)
+        std::uint64_t seed = 0;
+    };
+
+  protected:
+    Parameters parameters;
+    GeoGrid<double> grid;
+    std::size_t region_cols;  // regions are laid out as tiles, region_cols per row
+    std::size_t region_rows;
+
+    // uniformly distributed in [0, 1) depending only on seed, stream and index
+    double uniform(std::uint64_t stream, std::uint64_t index) const;
+    // creates file with lat and lon dimensions and coordinate variables
+    void create(netCDF::NcFile& file, const std::string& filename) const;
+    // adds variable (chunked and compressed if compression level is set)
+    netCDF::NcVar add_variable(netCDF::NcFile& file, const std::string& name, const netCDF::NcType& type, const std::vector<netCDF::NcDim>& dims) const;
+    // land cells are assigned in blocks of about one degree to resemble continents
+    bool is_land(std::size_t lat_index, std::size_t lon_index) const;
+    // -1 for ocean cells
+    int region(std::size_t lat_index, std::size_t lon_index) const;
+    // writes outer_count slices of the lat/lon grid (innermost dimensions of variable), calling func(outer_index, lat_index, lon_index)
+    template<typename T, typename Function>
+    void write_slices(const netCDF::NcVar& variable, std::size_t outer_count, Function&& func) const;
+
+  public:
+    explicit Generator(const Parameters& parameters_p);
+    const GeoGrid<double>& get_grid() const { return grid; }
+    const Parameters& get_parameters() const { return parameters; }
+    std::string region_name(std::size_t region) const { return "R" + std::to_string(region); }
+    std::string sector_name(std::size_t sector) const { return "S" + std::to_string(sector); }
+    std::string time_units() const { return "days since " + std::to_string(parameters.year_from) + "-01-01"; }
+    // integer variable "isoraster" with region names in string variable "index"; sector names are given in string variable "sector"
+    void write_isoraster(const std::string& filename) const;
+    // variable "proxy" of positive values on land, zero on ocean
+    void write_proxy(const std::string& filename) const;
+    // variable "flood_fraction" (time, lat, lon), mostly zero, missing on ocean
+    void write_flood_fraction(const std::string& filename) const;
+    // variable "temperature" (time, lat, lon) in degrees Celsius, missing on ocean
+    void write_temperature(const std::string& filename) const;
+    // variable "wind" (realization, year, event, lat, lon) with one circular storm per event, integer variables "event_count"
+    // (realization, year) and "year" (year)
+    void write_tropical_cyclones(const std::string& filename) const;
+};
+
+}  // namespace impactgen
+
+#endif
@@ -21,53 +21,92 @@
 #ifndef IMPACTGEN_GEOGRID_H
 #define IMPACTGEN_GEOGRID_H
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
+#include "Profiling.h"
 #include "netcdftools.h"
 #include "nvector.h"
 
 namespace impactgen {
 
+template<typename T>
+struct GeoBox {
+    T lat_min = std::numeric_limits<T>::max();
+    T lat_max = std::numeric_limits<T>::lowest();
+    T lon_min = std::numeric_limits<T>::max();
+    T lon_max = std::numeric_limits<T>::lowest();
+
+    constexpr bool empty() const { return lat_min > lat_max || lon_min > lon_max; }
+    inline void extend(T lat, T lon) {
+        lat_min = std::min(lat_min, lat);
+        lat_max = std::max(lat_max, lat);
+        lon_min = std::min(lon_min, lon);
+        lon_max = std::max(lon_max, lon);
+    }
+    inline void extend(const GeoBox<T>& other) {
+        if (!other.empty()) {
+            extend(other.lat_min, other.lon_min);
+            extend(other.lat_max, other.lon_max);
+        }
+    }
+};
+
+// Regular lat/lon grid. Cells are indexed canonically, i.e. south to north and west to east with longitudes in -180..180 (if the grid is
+// given in 0..360, it is shifted, or rotated if it is global). The layout of the values as stored in the file may differ: the signs of
+// lat_stepsize and lon_stepsize give the stored directions and lon_rotation the stored column of the first canonical column (before
+// reversing); see stored_lat_index and stored_lon_index. Values are brought into canonical layout when reading (see to_canonical and
+// ForcingReader), so that views over them always have positive strides.
 template<typename T>
 struct GeoGrid {
     T lon_min = 0;
     T lon_max = 0;
-    T lon_stepsize = 0;
+    T lon_stepsize = 0;  // negative if stored east to west
     T lon_abs_stepsize = 0;
     std::size_t lon_count = 0;
     T lat_min = 0;
     T lat_max = 0;
-    T lat_stepsize = 0;
+    T lat_stepsize = 0;  // negative if stored north to south
     T lat_abs_stepsize = 0;
     std::size_t lat_count = 0;
+    std::size_t lon_rotation = 0;
 
     GeoGrid() = default;
-    void read_from_netcdf(const netCDF::NcFile& file, const std::string& filename);
+    void read_from_netcdf(const netCDF::NcGroup& file, const std::string& filename);
+    // part of this grid covering box (with a margin of one cell), first (canonical) indices of that part are returned in lat_begin and
+    // lon_begin
+    GeoGrid<T> subgrid(const GeoBox<T>& box, std::size_t& lat_begin, std::size_t& lon_begin) const;
     constexpr std::size_t size() const { return lat_count * lon_count; }
-    constexpr inline T lat(std::size_t lat_index) { return lat_min + lat_abs_stepsize * lat_index; }
-    constexpr inline T lon(std::size_t lon_index) { return lon_min + lon_abs_stepsize * lon_index; }
-    constexpr std::size_t lat_index(T lat) const {
-        T res;
-        if (lat_stepsize < 0) {
-            res = (lat_max - lat) * lat_count / (lat_max - lat_min - lat_stepsize);
-        } else {
-            res = (lat - lat_min) * lat_count / (lat_max - lat_min + lat_stepsize);
-        }
+    constexpr bool is_canonical() const { return lat_stepsize > 0 && lon_stepsize > 0 && lon_rotation == 0; }
+    constexpr T lat(std::size_t lat_index) const { return lat_min + lat_abs_stepsize * lat_index; }
+    constexpr T lon(std::size_t lon_index) const { return lon_min + lon_abs_stepsize * lon_index; }
+    // index as stored in the file of the cell at a canonical index (and vice versa)
+    constexpr std::size_t stored_lat_index(std::size_t lat_index) const { return lat_stepsize < 0 ? lat_count - 1 - lat_index : lat_index; }
+    constexpr std::size_t stored_lon_index(std::size_t lon_index) const {
+        return lon_stepsize < 0 ? lon_count - 1 - (lon_index + lon_rotation) % lon_count : (lon_index + lon_rotation) % lon_count;
+    }
+    constexpr std::size_t canonical_lat_index(std::size_t stored_index) const { return stored_lat_index(stored_index); }
+    constexpr std::size_t canonical_lon_index(std::size_t stored_index) const {
+        return ((lon_stepsize < 0 ? lon_count - 1 - stored_index : stored_index) + lon_count - lon_rotation) % lon_count;
+    }
+    // index of the cell whose center is closest to the given coordinate (not necessarily within [0, count))
+    long nearest_lat_index(T lat_p) const { return std::lround((lat_p - lat_min) / lat_abs_stepsize); }
+    long nearest_lon_index(T lon_p) const { return std::lround((lon_p - lon_min) / lon_abs_stepsize); }
+    constexpr std::size_t lat_index(T lat_p) const {
+        const T res = (lat_p - lat_min) * lat_count / (lat_max - lat_min + lat_abs_stepsize);
         if (res < 0 || res >= lat_count) {
             return std::numeric_limits<std::size_t>::quiet_NaN();
         }
         return static_cast<std::size_t>(res);
     }
-    constexpr std::size_t lon_index(T lon) const {
-        T res;
-        if (lon_stepsize < 0) {
-            res = (lon_max - lon) * lon_count / (lon_max - lon_min - lon_stepsize);
-        } else {
-            res = (lon - lon_min) * lon_count / (lon_max - lon_min + lon_stepsize);
-        }
+    constexpr std::size_t lon_index(T lon_p) const {
+        const T res = (lon_p - lon_min) * lon_count / (lon_max - lon_min + lon_abs_stepsize);
         if (res < 0 || res >= lon_count) {
             return std::numeric_limits<std::size_t>::quiet_NaN();
         }
@@ -78,39 +117,44 @@ struct GeoGrid {
         return std::abs(lat_abs_stepsize - other.lat_abs_stepsize) / lat_abs_stepsize < 1e-2
                && std::abs(lon_abs_stepsize - other.lon_abs_stepsize) / lon_abs_stepsize < 1e-2;
     }
-    template<typename V>
-    constexpr nvector::View<V, 2> box(
-        const nvector::View<V, 2>& view, T lat_min_p, T lat_max_p, T lon_min_p, T lon_max_p, std::size_t max_lat_size, std::size_t max_lon_size) const {
+    // reorders values of the whole grid read in stored layout into canonical layout (in place)
+    template<typename V, class Storage>
+    void to_canonical(nvector::Vector<V, 2, Storage>& values) const {
+        if (is_canonical()) {
+            return;
+        }
+        auto& data = values.data();
+        if (lat_stepsize < 0) {
+            for (std::size_t lat_index = 0; lat_index < lat_count / 2; ++lat_index) {
+                std::swap_ranges(std::begin(data) + lat_index * lon_count, std::begin(data) + (lat_index + 1) * lon_count,
+                                 std::begin(data) + (lat_count - 1 - lat_index) * lon_count);
+            }
+        }
+        for (std::size_t lat_index = 0; lat_index < lat_count; ++lat_index) {
+            const auto row = std::begin(data) + lat_index * lon_count;
+            if (lon_stepsize < 0) {
+                std::reverse(row, row + lon_count);
+            }
+            std::rotate(row, row + lon_rotation, row + lon_count);
+        }
+    }
+    template<typename V, typename Iterator, typename Tref>
+    constexpr nvector::View<V, 2, Iterator, Tref> box(const nvector::View<V, 2, Iterator, Tref>& view,
+                                                      T lat_min_p,
+                                                      T lat_max_p,
+                                                      T lon_min_p,
+                                                      T lon_max_p,
+                                                      std::size_t max_lat_size,
+                                                      std::size_t max_lon_size) const {
         const auto& lat_slice = view.template slice<0>();
         const auto& lon_slice = view.template slice<1>();
-        nvector::Slice new_lat_slice;
-        nvector::Slice new_lon_slice;
-
         const auto lat_min_index = lat_index(lat_min_p);
-        const auto lat_max_index = lat_index(lat_max_p);
-        if (lat_min_index > lat_max_index) {
-            new_lat_slice.begin = -lat_slice.begin - lat_min_index;
-            new_lat_slice.size = std::min(lat_min_index - lat_max_index, max_lat_size);
-            new_lat_slice.stride = -lat_slice.stride;
-        } else {
-            new_lat_slice.begin = lat_slice.begin + lat_min_index;
-            new_lat_slice.size = std::min(lat_max_index - lat_min_index, max_lat_size);
-            new_lat_slice.stride = lat_slice.stride;
-        }
-
         const auto lon_min_index = lon_index(lon_min_p);
-        const auto lon_max_index = lon_index(lon_max_p);
-        if (lon_min_index > lon_max_index) {
-            new_lon_slice.begin = -lon_slice.begin - lon_min_index;
-            new_lon_slice.size = std::min(lon_min_index - lon_max_index, max_lon_size);
-            new_lon_slice.stride = -lon_slice.stride;
-        } else {
-            new_lon_slice.begin = lon_slice.begin + lon_min_index;
-            new_lon_slice.size = std::min(lon_max_index - lon_min_index, max_lon_size);
-            new_lon_slice.stride = lon_slice.stride;
-        }
-
-        return typename nvector::View<V, 2>(view.data(), {new_lat_slice, new_lon_slice});
+        return typename nvector::View<V, 2, Iterator, Tref>(
+            view.data(), {nvector::Slice{static_cast<int>(lat_slice.begin + lat_min_index), std::min(lat_index(lat_max_p) - lat_min_index, max_lat_size),
+                                         lat_slice.stride},
+                          nvector::Slice{static_cast<int>(lon_slice.begin + lon_min_index), std::min(lon_index(lon_max_p) - lon_min_index, max_lon_size),
+                                         lon_slice.stride}});
     }
 };
 
@@ -133,12 +177,17 @@ inline T min(T a, T b) {
     return std::min(a, b);
 }
 
-template<typename V, typename T = float>
+template<typename V, typename T = float, typename Iterator = typename std::vector<V>::iterator, typename Tref = typename std::add_lvalue_reference<V>::type>
 struct GridView {
-    nvector::View<V, 2>& data;
-    GeoGrid<T>& grid;
+    const nvector::View<V, 2, Iterator, Tref>& data;
+    const GeoGrid<T>& grid;
 };
 
+template<typename V, typename T, typename Iterator, typename Tref>
+inline GridView<V, T, Iterator, Tref> make_grid_view(const nvector::View<V, 2, Iterator, Tref>& data, const GeoGrid<T>& grid) {
+    return {data, grid};
+}
+
 template<typename T, typename... Args>
 inline bool all_compatible(const GeoGrid<T>& grid1, const GeoGrid<T>& grid2) {
     return grid1.is_compatible(grid2);
@@ -151,6 +200,7 @@ inline bool all_compatible(const GeoGrid<T>& grid1, const GeoGrid<T>& grid2, con
 
 template<typename T, typename... Args>
 inline auto common_grid_view(GeoGrid<T>& common_grid, const Args&... grid_views) -> decltype(std::make_tuple(grid_views.data...)) {
+    IMPACTGEN_PROFILE("common_grid_view");
     common_grid.lat_min = reduce(max<T>, grid_views.grid.lat_min...);
     common_grid.lat_max = reduce(min<T>, grid_views.grid.lat_max...);
     common_grid.lon_min = reduce(max<T>, grid_views.grid.lon_min...);
@@ -0,0 +1,195 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_GRIDCACHE_H
+#define IMPACTGEN_GRIDCACHE_H
+
+#include <cstring>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include "DiskCache.h"
+#include "MemoryAccounting.h"
+#include "GeoGrid.h"
+#include "MappedStorage.h"
+#include "nvector.h"
+
+namespace impactgen {
+
+// values are used in place in the mapped cache file if loaded from the disk cache (see DiskCache)
+template<typename T>
+struct GridData {
+    GeoGrid<float> grid;
+    nvector::Vector<T, 2, MappedStorage<T>> values;  // of shape 1 x gathered.size() for gathered (land-only) inputs
+    std::vector<std::size_t> gathered;  // flattened lat/lon indices of the cells given in values, empty for full grids
+    std::vector<std::string> names;     // names of the indices used in values (for isorasters)
+
+    bool is_gathered() const { return !gathered.empty(); }
+
+    std::size_t memory_size() const {
+        std::size_t res = sizeof(*this) + values.data().heap_size() + gathered.capacity() * sizeof(std::size_t);
+        for (const auto& name : names) {
+            res += name.capacity();
+        }
+        return res;
+    }
+
+    void to_disk_cache(const std::string& source_filename, const std::string& key) const {
+        std::string joined_names;
+        for (const auto& name : names) {
+            joined_names.append(name).push_back('\0');
+        }
+        DiskCache::instance().store(source_filename, key,
+                                    {{&grid, sizeof(grid)},
+                                     {&values.data()[0], values.data().size() * sizeof(T)},
+                                     {joined_names.data(), joined_names.size()},
+                                     {gathered.data(), gathered.size() * sizeof(std::size_t)}});
+    }
+
+    bool from_disk_cache(const DiskCache::Entry& entry) {
+        if (entry.section_count() != 4) {
+            return false;
+        }
+        std::size_t count;
+        const auto* cached_grid = entry.section<char>(0, count);
+        if (count != sizeof(grid)) {
+            return false;
+        }
+        std::memcpy(&grid, cached_grid, sizeof(grid));
+        const auto* cached_gathered = entry.section<std::size_t>(3, count);
+        gathered.assign(cached_gathered, cached_gathered + count);
+        auto cached_values = entry.storage<T>(1);
+        if (is_gathered()) {
+            if (cached_values.size() != gathered.size()) {
+                return false;
+            }
+            // gathered values are accessed through the remapping onto other grids, i.e. in no particular order
+            cached_values.advise(MappedFile::Advice::RANDOM);
+            values.assign(std::move(cached_values), std::size_t(1), gathered.size());
+        } else {
+            if (cached_values.size() != grid.size()) {
+                return false;
+            }
+            // full grids are iterated row by row
+            cached_values.advise(MappedFile::Advice::SEQUENTIAL);
+            values.assign(std::move(cached_values), grid.lat_count, grid.lon_count);
+        }
+        const auto* cached_names = entry.section<char>(2, count);
+        names.clear();
+        for (std::size_t begin = 0, end = 0; end < count; ++end) {
+            if (cached_names[end] == '\0') {
+                names.emplace_back(cached_names + begin, end - begin);
+                begin = end + 1;
+            }
+        }
+        return true;
+    }
+};
+
+// Process-wide registry of data read from (static) input files, keyed by filename, variable and modification time of the file.
+// Entries stay available as long as they are referenced somewhere; unreferenced entries are kept in least-recently-used order up
+// to the memory limit. If a cache directory is set (see DiskCache), entries are also looked up there before being loaded from the
+// input file and stored there after loading; T then needs to provide to_disk_cache and from_disk_cache.
+class GridCache {
+  protected:
+    struct Key {
+        std::string filename;
+        std::string variable;
+        std::time_t mtime;
+        std::type_index type;
+        bool operator==(const Key& other) const {
+            return mtime == other.mtime && type == other.type && filename == other.filename && variable == other.variable;
+        }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+    struct Entry {
+        std::weak_ptr<const void> value;
+        std::shared_ptr<const void> kept;  // null if not held by the cache itself
+        std::size_t size;
+        std::list<const Key*>::iterator lru_position;
+    };
+
+    std::mutex mutex_m;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::list<const Key*> lru;  // most recently used first
+    std::size_t memory_limit = std::size_t(1) << 30;
+    std::size_t memory_kept = 0;
+
+    GridCache() = default;
+    std::shared_ptr<const void> find(const Key& key);
+    void insert(const Key& key, std::shared_ptr<const void> value, std::size_t size);
+    void keep(Entry& entry, const Key* key);
+    void shrink(std::size_t limit);
+
+  public:
+    GridCache(const GridCache&) = delete;
+    GridCache& operator=(const GridCache&) = delete;
+    static GridCache& instance();
+    static std::time_t modification_time(const std::string& filename);
+    void set_memory_limit(std::size_t memory_limit_p);
+    std::size_t get_memory_kept();
+    // drops all entries not referenced elsewhere
+    void evict_unused();
+
+    template<typename T, typename Loader>
+    std::shared_ptr<const T> get(const std::string& filename, const std::string& variable, Loader&& load) {
+        const Key key{filename, variable, modification_time(filename), std::type_index(typeid(T))};
+        auto res = std::static_pointer_cast<const T>(find(key));
+        if (!res) {
+            // not under lock as reading might take long
+            auto& disk_cache = DiskCache::instance();
+            const auto disk_key = variable + "@" + typeid(T).name();
+            const auto entry = disk_cache.load(filename, disk_key);
+            if (entry) {
+                auto cached = std::make_shared<T>();
+                if (cached->from_disk_cache(*entry)) {
+                    res = std::move(cached);
+                }
+            }
+            if (!res) {
+                res = load();
+                if (disk_cache.enabled()) {
+                    res->to_disk_cache(filename, disk_key);
+                }
+            }
+            // memory is accounted for as long as the value is referenced anywhere
+            struct Tracked {
+                std::shared_ptr<const T> value;
+                TrackedMemory memory;
+            };
+            const auto size = res->memory_size();
+            auto tracked = std::make_shared<Tracked>(Tracked{std::move(res), TrackedMemory(MemorySubsystem::GRIDS, size)});
+            res = std::shared_ptr<const T>(tracked, tracked->value.get());
+            insert(key, res, size);
+        }
+        return res;
+    }
+};
+
+}  // namespace impactgen
+
+#endif
@@ -0,0 +1,56 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_INPUTFILE_H
+#define IMPACTGEN_INPUTFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "netcdftools.h"
+
+namespace impactgen {
+
+// Opened netCDF input file. Filenames of the form "archive.zip#path/in/zip.nc" refer to a member of a zip archive, which is then
+// decompressed into memory (archives are kept open for later use).
+class InputFile : public netCDF::NcGroup {
+  protected:
+    std::string filename;
+    std::vector<char> memory;  // decompressed contents for archive members
+
+  public:
+    // split filename into archive and member path, returns false if filename does not refer to an archive member
+    static bool split_archive_path(const std::string& filename, std::string& archive, std::string& member);
+    // path of the file on disk (i.e. of the archive for archive members)
+    static std::string physical_path(const std::string& filename);
+
+    explicit InputFile(std::string filename_p);
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+    ~InputFile();
+    const std::string& name() const { return filename; }
+    bool in_memory() const { return !memory.empty(); }
+    const char* data() const { return &memory[0]; }
+    std::size_t size() const { return memory.size(); }
+};
+
+}  // namespace impactgen
+
+#endif
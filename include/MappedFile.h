@@ -0,0 +1,65 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_MAPPEDFILE_H
+#define IMPACTGEN_MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace impactgen {
+
+// memory mapping of a whole file, read-only or copy-on-write (writes stay private to the process), or of an anonymous scratch file
+// (for data that should be paged out to disk rather than held in memory)
+class MappedFile {
+  public:
+    enum class Mode { READ_ONLY, COPY_ON_WRITE, SCRATCH };
+    // expected access pattern, passed to the kernel as madvise hint
+    enum class Advice { NORMAL, SEQUENTIAL, RANDOM, WILLNEED };
+
+  protected:
+    void* data_m = nullptr;
+    std::size_t size_m = 0;
+    Mode mode = Mode::READ_ONLY;
+
+    MappedFile() = default;
+    void map(int fd, const std::string& filename);
+
+  public:
+    explicit MappedFile(const std::string& filename, Mode mode_p = Mode::READ_ONLY);
+    // zero-initialized scratch mapping of size bytes backed by an unnamed file in directory
+    static std::unique_ptr<MappedFile> scratch(const std::string& directory, std::size_t size);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    const char* data() const { return static_cast<const char*>(data_m); }
+    // only for mappings not READ_ONLY
+    char* writable_data() const { return mode == Mode::READ_ONLY ? nullptr : static_cast<char*>(data_m); }
+    std::size_t size() const { return size_m; }
+    Mode get_mode() const { return mode; }
+    // for the pages covering [begin, begin + length), which need to be within the mapping
+    void advise(Advice advice, const void* begin, std::size_t length) const;
+    void advise(Advice advice) const { advise(advice, data_m, size_m); }
+};
+
+}  // namespace impactgen
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_MAPPEDSTORAGE_H
+#define IMPACTGEN_MAPPEDSTORAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace impactgen {
+
+// Storage for nvector::Vector holding its elements either on the heap or in a memory-mapped file (see MappedFile), so that large
+// grids are paged in on demand instead of being read into memory as a whole. Copies of mapped storage share the mapping; resizing
+// moves the elements to the heap first. Elements of read-only mappings must not be written to.
+template<typename T>
+class MappedStorage {
+  protected:
+    std::vector<T> heap;
+    std::shared_ptr<const MappedFile> file;  // keeps the mapping alive, null for heap storage
+    T* data_m = nullptr;
+    std::size_t size_m = 0;
+
+  public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    MappedStorage() = default;
+    // size_p elements at data_p within the mapping of file_p
+    MappedStorage(std::shared_ptr<const MappedFile> file_p, T* data_p, std::size_t size_p) : file(std::move(file_p)), data_m(data_p), size_m(size_p) {}
+    MappedStorage(const MappedStorage& other) : heap(other.heap), file(other.file), data_m(other.file ? other.data_m : heap.data()), size_m(other.size_m) {}
+    MappedStorage(MappedStorage&& other) noexcept
+        : heap(std::move(other.heap)), file(std::move(other.file)), data_m(other.data_m), size_m(other.size_m) {
+        other.data_m = nullptr;
+        other.size_m = 0;
+    }
+    MappedStorage& operator=(MappedStorage other) noexcept {
+        std::swap(heap, other.heap);
+        std::swap(file, other.file);
+        std::swap(data_m, other.data_m);
+        std::swap(size_m, other.size_m);
+        return *this;
+    }
+
+    // size_p elements set to value in a scratch mapping in directory (see MappedFile::scratch)
+    static MappedStorage scratch(const std::string& directory, std::size_t size_p, const T& value = T()) {
+        std::shared_ptr<const MappedFile> mapped = MappedFile::scratch(directory, size_p * sizeof(T));
+        MappedStorage res(mapped, reinterpret_cast<T*>(mapped->writable_data()), size_p);
+        if (!(value == T())) {  // scratch files are zero-initialized
+            std::fill(res.begin(), res.end(), value);
+        }
+        return res;
+    }
+
+    bool is_mapped() const { return file != nullptr; }
+    std::size_t size() const { return size_m; }
+    bool empty() const { return size_m == 0; }
+    T* data() { return data_m; }
+    const T* data() const { return data_m; }
+    iterator begin() { return data_m; }
+    iterator end() { return data_m + size_m; }
+    const_iterator begin() const { return data_m; }
+    const_iterator end() const { return data_m + size_m; }
+    T& operator[](std::size_t i) { return data_m[i]; }
+    const T& operator[](std::size_t i) const { return data_m[i]; }
+    // in bytes, not counting mapped elements (which the kernel can drop from memory at any time)
+    std::size_t heap_size() const { return heap.capacity() * sizeof(T); }
+
+    void resize(std::size_t size_p, const T& value = T()) {
+        if (file) {
+            heap.assign(data_m, data_m + std::min(size_m, size_p));
+            file.reset();
+        }
+        heap.resize(size_p, value);
+        data_m = heap.data();
+        size_m = size_p;
+    }
+
+    void advise(MappedFile::Advice advice) const {
+        if (file) {
+            file->advise(advice, data_m, size_m * sizeof(T));
+        }
+    }
+};
+
+}  // namespace impactgen
+
+#endif
@@ -0,0 +1,133 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_MEMORYACCOUNTING_H
+#define IMPACTGEN_MEMORYACCOUNTING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace impactgen {
+
+enum class MemorySubsystem : std::size_t {
+    CHUNK_BUFFERS,   // buffers of ForcingReader
+    GRIDS,           // grids read from input files (GridCache) and per-cell state of impacts
+    FORCING_SERIES,  // forcing series built by impacts
+    PROXY_CACHE,     // region points of proxied impacts
+    OUTPUT,          // forcing series held by Output until written
+    ARENA            // buffers and forcings kept by impacts for reuse (see Arena and ForcingPool)
+};
+constexpr std::size_t memory_subsystem_count = 6;
+const char* memory_subsystem_name(MemorySubsystem subsystem);
+
+// Process-wide accounting of the memory used by the main data structures, by subsystem. With a memory limit set, subsystems adapt
+// when the total exceeds the pressure threshold (a fraction of the limit): registered reclaimers (evicting caches) are run, readers
+// shrink their chunks and Output combines its pending series early. Allocations that would still exceed the limit throw.
+class MemoryAccounting {
+  protected:
+    std::array<std::atomic<std::size_t>, memory_subsystem_count> current{};
+    std::array<std::atomic<std::size_t>, memory_subsystem_count> peak{};
+    std::atomic<std::size_t> total{0};
+    std::atomic<std::size_t> total_peak{0};
+    std::size_t limit = 0;  // no limit if 0
+    std::size_t pressure_threshold = 0;
+    std::mutex reclaimers_mutex;
+    std::vector<std::function<void()>> reclaimers;
+    std::atomic<bool> reclaiming{false};
+
+    MemoryAccounting() = default;
+    void reclaim();
+
+  public:
+    MemoryAccounting(const MemoryAccounting&) = delete;
+    MemoryAccounting& operator=(const MemoryAccounting&) = delete;
+    static MemoryAccounting& instance();
+    // in bytes, 0 for no limit
+    void set_limit(std::size_t limit_p);
+    std::size_t get_limit() const { return limit; }
+    void add_reclaimer(std::function<void()> reclaimer);
+    void allocate(MemorySubsystem subsystem, std::size_t bytes);
+    void release(MemorySubsystem subsystem, std::size_t bytes);
+    std::size_t get_current(MemorySubsystem subsystem) const { return current[static_cast<std::size_t>(subsystem)]; }
+    std::size_t get_peak(MemorySubsystem subsystem) const { return peak[static_cast<std::size_t>(subsystem)]; }
+    std::size_t get_total() const { return total; }
+    std::size_t get_total_peak() const { return total_peak; }
+    bool under_pressure() const { return limit > 0 && total > pressure_threshold; }
+    // largest count not above max_count (but at least 1) of items of item_size bytes that fit below the pressure threshold
+    std::size_t fitting_count(std::size_t max_count, std::size_t item_size) const;
+    void write_report(std::ostream& out) const;
+};
+
+// Memory accounted for as long as this object lives, to be kept next to the data it accounts for
+class TrackedMemory {
+  protected:
+    MemorySubsystem subsystem;
+    std::size_t bytes = 0;
+
+  public:
+    explicit TrackedMemory(MemorySubsystem subsystem_p, std::size_t bytes_p = 0) : subsystem(subsystem_p) { set(bytes_p); }
+    TrackedMemory(const TrackedMemory& other) : TrackedMemory(other.subsystem, other.bytes) {}
+    TrackedMemory(TrackedMemory&& other) noexcept : subsystem(other.subsystem), bytes(other.bytes) { other.bytes = 0; }
+    TrackedMemory& operator=(const TrackedMemory& other) {
+        if (this != &other) {
+            set(0);
+            subsystem = other.subsystem;
+            set(other.bytes);
+        }
+        return *this;
+    }
+    TrackedMemory& operator=(TrackedMemory&& other) noexcept {
+        if (this != &other) {
+            MemoryAccounting::instance().release(subsystem, bytes);
+            subsystem = other.subsystem;
+            bytes = other.bytes;
+            other.bytes = 0;
+        }
+        return *this;
+    }
+    ~TrackedMemory() { MemoryAccounting::instance().release(subsystem, bytes); }
+
+    std::size_t size() const { return bytes; }
+    void set(std::size_t bytes_p) {
+        if (bytes_p > bytes) {
+            MemoryAccounting::instance().allocate(subsystem, bytes_p - bytes);
+        } else {
+            MemoryAccounting::instance().release(subsystem, bytes - bytes_p);
+        }
+        bytes = bytes_p;
+    }
+    void set_subsystem(MemorySubsystem subsystem_p) {
+        if (subsystem_p != subsystem) {
+            const auto b = bytes;
+            set(0);
+            subsystem = subsystem_p;
+            set(b);
+        }
+    }
+};
+
+}  // namespace impactgen
+
+#endif
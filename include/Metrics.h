@@ -0,0 +1,97 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_METRICS_H
+#define IMPACTGEN_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace impactgen {
+
+// Live metrics of a running job, served in Prometheus text format over HTTP on a Unix socket or a localhost TCP port (only if
+// started). Counters are attributed to the impact currently being joined; its progress (combinations and steps of the current join)
+// gives its estimated time remaining. Memory use and queue depths of subsystems are set by the subsystems themselves.
+class Metrics {
+  protected:
+    struct ImpactStats {
+        std::string name;
+        std::chrono::steady_clock::time_point begin;
+        std::atomic<double> elapsed_seconds{-1};  // set when finished
+        std::atomic<std::uint64_t> cells{0};
+        std::atomic<std::uint64_t> timesteps{0};
+        std::atomic<std::uint64_t> bytes_read{0};
+        std::size_t combination_count;
+        std::atomic<std::size_t> combinations_done{0};
+        std::atomic<std::size_t> join_step_count{0};
+        std::atomic<std::size_t> join_steps_done{0};
+    };
+
+    std::atomic<bool> enabled_m{false};
+    std::atomic<bool> stopping{false};
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    mutable std::mutex mutex;
+    std::deque<ImpactStats> impacts;  // deque for stable addresses
+    std::atomic<ImpactStats*> current{nullptr};
+    std::map<std::string, std::size_t> queue_depths;
+    int listen_fd = -1;
+    std::string socket_path;
+    std::thread server;
+
+    Metrics() = default;
+    void serve();
+    std::string render() const;
+
+  public:
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+    ~Metrics() { stop(); }
+    static Metrics& instance();
+    bool enabled() const { return enabled_m.load(std::memory_order_relaxed); }
+    // serves on Unix socket socket_path_p if not empty, otherwise on 127.0.0.1:port
+    void start(const std::string& socket_path_p, int port);
+    void stop();
+
+    void begin_impact(const std::string& name, std::size_t combination_count);
+    void end_combination();
+    void end_impact();
+    // step_count steps (time steps or years) are to be processed in the current join
+    void begin_join(std::size_t step_count);
+    void end_join_step(std::uint64_t timesteps = 1);
+    void add_read(std::uint64_t cells, std::uint64_t bytes) {
+        auto* stats = current.load(std::memory_order_relaxed);
+        if (stats) {
+            stats->cells.fetch_add(cells, std::memory_order_relaxed);
+            stats->bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+    void set_queue_depth(const std::string& queue, std::size_t depth);
+};
+
+}  // namespace impactgen
+
+#endif
@@ -29,6 +29,8 @@
 #include "Forcing.h"
 #include "ForcingSeries.h"
 #include "ReferenceTime.h"
+#include "Resampling.h"
+#include "TimeVariable.h"
 #include "netcdftools.h"
 #include "settingsnode.h"
 
@@ -39,23 +41,36 @@ class AgentForcing;
 class Output {
   protected:
     std::unique_ptr<ForcingSeries<AgentForcing>> agent_forcing;
+    std::vector<ForcingSeries<AgentForcing>> leaves;  // series to be combined when writing (in lazy mode, folded early under memory pressure)
     std::vector<std::string> regions;
     std::vector<std::string> sectors;
     ReferenceTime reference_time;
+    TimeRange time_range;
+    calendar::MissingDates missing_dates = calendar::MissingDates::PREVIOUS_DAY;
     std::string filename;
     std::string settings_string;
     netCDF::NcFile file;
     void append_array(const settings::SettingsNode& node, std::vector<std::string>& out);
     ForcingCombination combination;
+    bool quantize;
+    bool lazy;
+    Resampling resampling;
+    void include_series(ForcingSeries<AgentForcing>&& forcing);
+    void fold_leaves();
+    void update_metrics() const;
 
   public:
     explicit Output(const settings::SettingsNode& settings);
     const ReferenceTime& ref() const { return reference_time; }
+    const TimeRange& get_time_range() const { return time_range; }
+    calendar::MissingDates get_missing_dates() const { return missing_dates; }
     const std::vector<std::string>& get_regions() const { return regions; }
     void add_regions(const settings::SettingsNode& regions_node);
     void add_sectors(const settings::SettingsNode& sectors_node);
     template<class Forcing>
     void include_forcing(const ForcingSeries<Forcing>& forcing);
+    template<class Forcing>
+    void include_forcing(ForcingSeries<Forcing>&& forcing);
     AgentForcing prepare_forcing() const;
     void open();
     void close();
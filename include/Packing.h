@@ -0,0 +1,57 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_PACKING_H
+#define IMPACTGEN_PACKING_H
+
+#include <cstddef>
+#include <vector>
+#include "ClassicNetCDF.h"
+#include "Forcing.h"
+#include "netcdftools.h"
+
+namespace impactgen {
+
+// CF packing (scale_factor, add_offset) and missing value (_FillValue, missing_value) attributes of a variable. Raw values in the
+// variable's own type are unpacked to ForcingType with missing values mapped to NaN, so that kernels only need to check for invalid
+// forcing values (see max_valid_forcing).
+class Packing {
+  protected:
+    ClassicNetCDF::Type type = ClassicNetCDF::Type::FLOAT;
+    ForcingType scale_factor = 1;
+    ForcingType add_offset = 0;
+    std::vector<double> missing_values;  // _FillValue (or default fill value of type) and all values of missing_value
+
+    template<typename T>
+    void unpack_typed(const void* in, ForcingType* out, std::size_t size) const;
+
+  public:
+    explicit Packing(const netCDF::NcVar& variable);
+    ClassicNetCDF::Type raw_type() const { return type; }
+    std::size_t raw_size() const { return ClassicNetCDF::type_size(type); }
+    // true if raw values can be used as they are (unpacked floats whose missing values are not valid forcing values anyway)
+    bool is_trivial() const;
+    // in holds size values of raw_type() in native byte order (aligned for that type)
+    void unpack(const void* in, ForcingType* out, std::size_t size) const;
+};
+
+}  // namespace impactgen
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_PROFILING_H
+#define IMPACTGEN_PROFILING_H
+
+// Built-in instrumentation, only compiled in with IMPACTGEN_PROFILING (otherwise the macros below expand to nothing). Scoped timers
+// record the duration of phases (nested phases are included in their enclosing ones) per thread, attributed to the impact and
+// combination currently being joined; additionally, bytes read per file are counted. At the end of a run, a JSON summary and a
+// timeline in Chrome's trace_event format (to be opened in chrome://tracing or Perfetto) can be written.
+
+#ifdef IMPACTGEN_PROFILING
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace impactgen {
+namespace profiling {
+
+class Profiler {
+  protected:
+    struct Event {
+        const char* phase;
+        std::size_t context;
+        std::int64_t begin;  // in microseconds since start
+        std::int64_t duration;
+    };
+    struct Context {
+        std::string impact;
+        std::string combination;
+    };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mutable std::mutex mutex;
+    std::vector<Context> contexts = {{"", ""}};
+    std::atomic<std::size_t> current_context{0};
+    std::vector<std::unique_ptr<std::vector<Event>>> thread_events;  // index is the thread id used in the reports
+    std::unordered_map<std::string, std::uint64_t> bytes_read;
+
+    Profiler() = default;
+    std::vector<Event>& events_of_this_thread();
+
+  public:
+    static Profiler& instance();
+    std::int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    // attribute all following phases (of all threads) to this impact and combination
+    void set_context(std::string impact, std::string combination);
+    void record(const char* phase, std::int64_t begin, std::int64_t end);
+    void add_bytes_read(const std::string& filename, std::uint64_t bytes);
+    void write_summary(const std::string& filename) const;
+    void write_trace(const std::string& filename) const;
+};
+
+class ScopedTimer {
+  protected:
+    const char* phase;  // needs to be a string literal
+    std::int64_t begin;
+
+  public:
+    explicit ScopedTimer(const char* phase_p) : phase(phase_p), begin(Profiler::instance().now()) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer() { Profiler::instance().record(phase, begin, Profiler::instance().now()); }
+};
+
+}  // namespace profiling
+}  // namespace impactgen
+
+#define IMPACTGEN_PROFILE_CONCAT_(a, b) a##b
+#define IMPACTGEN_PROFILE_CONCAT(a, b) IMPACTGEN_PROFILE_CONCAT_(a, b)
+#define IMPACTGEN_PROFILE(phase) const ::impactgen::profiling::ScopedTimer IMPACTGEN_PROFILE_CONCAT(impactgen_profile_timer_, __LINE__)(phase)
+#define IMPACTGEN_PROFILE_CONTEXT(impact, combination) ::impactgen::profiling::Profiler::instance().set_context(impact, combination)
+#define IMPACTGEN_PROFILE_BYTES(filename, bytes) ::impactgen::profiling::Profiler::instance().add_bytes_read(filename, bytes)
+
+#else
+
+#define IMPACTGEN_PROFILE(phase)
+#define IMPACTGEN_PROFILE_CONTEXT(impact, combination)
+#define IMPACTGEN_PROFILE_BYTES(filename, bytes)
+
+#endif
+
+#endif
@@ -23,6 +23,7 @@
 
 #include <ctime>
 #include <string>
+#include "Calendar.h"
 
 namespace impactgen {
 
@@ -30,15 +31,19 @@ class ReferenceTime {
   protected:
     std::time_t time = -1;
     int accuracy = 1;
+    Calendar calendar = Calendar::STANDARD;
 
   public:
-    explicit constexpr ReferenceTime(std::time_t time_p = -1, int accuracy_p = 1) : time(time_p), accuracy(accuracy_p) {}
-    explicit ReferenceTime(const std::string& netcdf_format);
-    static std::time_t year(int year_p);
+    explicit constexpr ReferenceTime(std::time_t time_p = -1, int accuracy_p = 1, Calendar calendar_p = Calendar::STANDARD)
+        : time(time_p), accuracy(accuracy_p), calendar(calendar_p) {}
+    explicit ReferenceTime(const std::string& netcdf_format, Calendar calendar_p = Calendar::STANDARD);
+    static constexpr std::time_t year(int year_p, Calendar calendar_p = Calendar::STANDARD) { return calendar::to_time(calendar_p, {year_p, 1, 1}); }
     std::string to_netcdf_format() const;
     constexpr int reference(std::time_t time_p) const { return (time_p - time) / accuracy; }
-    constexpr std::time_t unreference(int time_p) const { return time_p * accuracy + time; }
-    constexpr bool compatible_with(const ReferenceTime& other) const { return other.accuracy == accuracy; }
+    constexpr std::time_t unreference(int time_p) const { return static_cast<std::time_t>(time_p) * accuracy + time; }
+    constexpr int get_accuracy() const { return accuracy; }
+    constexpr Calendar get_calendar() const { return calendar; }
+    constexpr bool compatible_with(const ReferenceTime& other) const { return other.accuracy == accuracy && other.calendar == calendar; }
 };
 
 }  // namespace impactgen
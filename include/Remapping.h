@@ -0,0 +1,60 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_REMAPPING_H
+#define IMPACTGEN_REMAPPING_H
+
+#include <cstddef>
+#include <vector>
+#include "Gathering.h"
+
+namespace impactgen {
+
+// Conservative remapping of an extensive quantity (e.g. proxy values) given on the cells of a source grid onto the cells of one or two
+// target grids of possibly different resolution (e.g. isoraster and forcing grid). Source cells are split into pieces along the cell
+// edges of the targets, each piece receiving the share of the source cell corresponding to its area on the sphere. If every target cell
+// is a union of whole source cells (integer refinement with aligned edges), pieces are just the source cells, i.e. values are block
+// summed.
+class ConservativeRemapping {
+  public:
+    struct Piece {
+        std::size_t target1;  // position in first target, GridCells::npos if not covered
+        std::size_t target2;  // position in second target, GridCells::npos if not covered or no second target given
+        double fraction;      // of source cell area
+        float lat;            // center of piece
+        float lon;
+    };
+
+  protected:
+    const GridCells& source;
+    const GridCells& target1;
+    const GridCells* target2;
+    bool block_sum;
+
+  public:
+    ConservativeRemapping(const GridCells& source_p, const GridCells& target1_p, const GridCells* target2_p = nullptr);
+    bool is_block_sum() const { return block_sum; }
+    // pieces of source cell at position (replacing the contents of res)
+    void pieces(std::size_t position, std::vector<Piece>& res) const;
+};
+
+}  // namespace impactgen
+
+#endif
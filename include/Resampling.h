@@ -0,0 +1,72 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPACTGEN_RESAMPLING_H
+#define IMPACTGEN_RESAMPLING_H
+
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <vector>
+#include "Forcing.h"
+#include "ForcingSeries.h"
+#include "ReferenceTime.h"
+#include "settingsnode.h"
+
+namespace impactgen {
+
+// Temporal resampling of forcing series to weeks (counted from the output reference time) or calendar months. Each series is
+// resampled when included into the output so that its native resolution is never stored there.
+class Resampling {
+  public:
+    enum class Period { NONE, WEEK, MONTH };
+
+  protected:
+    Period period = Period::NONE;
+    ForcingAggregation aggregation = ForcingAggregation::MEAN;
+    ReferenceTime reference_time;
+
+  public:
+    Resampling() = default;
+    Resampling(const settings::SettingsNode& node, ReferenceTime reference_time_p);
+    constexpr bool enabled() const { return period != Period::NONE; }
+    std::time_t period_begin(std::time_t time) const;
+    std::time_t period_end(std::time_t begin) const;
+
+    template<class Forcing>
+    ForcingSeries<Forcing> apply(const ForcingSeries<Forcing>& series) const {
+        std::map<std::time_t, std::vector<const Forcing*>> operands;
+        series.foreach_forcing([&](std::time_t time, const Forcing& forcing) { operands[period_begin(time)].push_back(&forcing); });
+        ForcingSeries<Forcing> res(series.base_forcing, series.reference_time);
+        const auto accuracy = series.reference_time.get_accuracy();
+        for (const auto& period_operands : operands) {
+            const auto begin = period_operands.first;
+            const std::size_t step_count = (period_end(begin) - begin) / accuracy;
+            Forcing forcing(series.base_forcing);
+            forcing.aggregate(period_operands.second, step_count, aggregation);
+            res.insert_forcing(begin, std::move(forcing));
+        }
+        return res;
+    }
+};
+
+}  // namespace impactgen
+
+#endif
@@ -22,22 +22,46 @@
 #define IMPACTGEN_TIMEVARIABLE_H
 
 #include <ctime>
+#include <limits>
 #include <vector>
 #include "ReferenceTime.h"
 #include "netcdftools.h"
+#include "settingsnode.h"
 
 namespace impactgen {
 
+// half-open interval [from, to) of calendar dates, read from settings as {from, to} (both inclusive, given as year or date);
+// resolved to times in the calendar of the respective time axis
+struct TimeRange {
+    calendar::Date from{std::numeric_limits<int>::lowest(), 1, 1};
+    calendar::Date to{std::numeric_limits<int>::max(), 1, 1};
+
+    TimeRange() = default;
+    explicit TimeRange(const settings::SettingsNode& node);
+    bool unbounded() const;
+    std::time_t begin(Calendar calendar) const;
+    std::time_t end(Calendar calendar) const;
+    bool contains(std::time_t t, Calendar calendar) const { return t >= begin(calendar) && t < end(calendar); }
+    TimeRange intersect(const TimeRange& other) const;
+};
+
 class TimeVariable {
   protected:
     ReferenceTime reference_time;
 
   public:
     std::vector<std::time_t> times;
+    std::size_t offset = 0;  // index of times[0] in time axis of file
+    std::vector<bool> dropped;  // time steps to skip (only set by convert_to, otherwise empty)
 
-    explicit TimeVariable(const netCDF::NcFile& file, const std::string& filename, int time_shift = 0);
+    explicit TimeVariable(const netCDF::NcGroup& file, const std::string& filename, int time_shift = 0, const TimeRange& range = TimeRange());
     explicit TimeVariable(std::vector<std::time_t> times_p, ReferenceTime reference_time_p);
     inline const ReferenceTime& ref() const { return reference_time; }
+    // converts times (and reference time) to calendar_p keeping their dates, e.g. to match the calendar of the output; time steps
+    // with dates missing there are handled according to missing_dates, also dropping those that would end up at a time already
+    // taken by another time step; returns number of dropped time steps
+    std::size_t convert_to(Calendar calendar_p, calendar::MissingDates missing_dates);
+    inline bool is_dropped(std::size_t t) const { return !dropped.empty() && dropped[t]; }
     void write_to_file(const netCDF::NcFile& file, const ReferenceTime& reference_time_p);
 };
 
@@ -24,6 +24,7 @@
 #include <memory>
 #include <vector>
 #include "AgentForcing.h"
+#include "ForcingSeries.h"
 #include "settingsnode.h"
 
 namespace impactgen {
@@ -32,6 +33,8 @@ class AgentImpact {
   protected:
     std::vector<int> sectors;
     const AgentForcing base_forcing;
+    // forcings of the series passed to Output are reused for later joins once Output has combined them
+    std::shared_ptr<ForcingPool<AgentForcing>> forcing_pool = std::make_shared<ForcingPool<AgentForcing>>();
 
     explicit AgentImpact(AgentForcing base_forcing_p) : base_forcing(std::move(base_forcing_p)) {}
     void read_sectors(const settings::SettingsNode& impact_node);
@@ -22,6 +22,8 @@
 #define IMPACTGEN_FLOODING_H
 
 #include <string>
+#include <vector>
+#include "MappedStorage.h"
 #include "impacts/AgentImpact.h"
 #include "impacts/Impact.h"
 #include "impacts/ProxiedImpact.h"
@@ -34,13 +36,23 @@ class Output;
 
 class Flooding : public AgentImpact, public ProxiedImpact, public Impact {
   protected:
-    nvector::Vector<ForcingType, 2> last;
+    static constexpr std::size_t scratch_min_size = std::size_t(64) << 20;  // in bytes
+    // kept in a scratch file in the cache directory (if set) for large grids, so that it can be paged out (see MappedStorage)
+    nvector::Vector<ForcingType, 2, MappedStorage<ForcingType>> last;
     GeoGrid<float> last_grid;
+    std::vector<ForcingType> last_points;  // when aggregating in gathered space, for cells last_cells (see RegionPoints)
+    std::vector<std::size_t> last_cells;
+    TrackedMemory last_memory{MemorySubsystem::GRIDS};  // of last and last_points/last_cells
     ForcingType recovery_exponent;
     ForcingType recovery_threshold;
     std::string forcing_filename;
     std::string forcing_varname;
 
+    void remap_last_points(const RegionPoints& points);
+    void account_last() {
+        last_memory.set(last.data().heap_size() + last_points.capacity() * sizeof(ForcingType) + last_cells.capacity() * sizeof(std::size_t));
+    }
+
   public:
     Flooding(const settings::SettingsNode& impact_node, AgentForcing base_forcing_p);
     void join(Output& output, const TemplateFunction& template_func) override;
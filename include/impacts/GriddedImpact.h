@@ -21,9 +21,12 @@
 #ifndef IMPACTGEN_GRIDDED_IMPACT_H
 #define IMPACTGEN_GRIDDED_IMPACT_H
 
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include "GeoGrid.h"
+#include "GridCache.h"
 #include "nvector.h"
 #include "settingsnode.h"
 
@@ -31,8 +34,8 @@ namespace impactgen {
 
 class GriddedImpact {
   protected:
-    nvector::Vector<int, 2> isoraster;
-    GeoGrid<float> isoraster_grid;
+    std::shared_ptr<const GridData<int>> isoraster;
+    std::string isoraster_id;  // identifies isoraster file and variable (for caching data derived from it)
     std::vector<int> regions;
 
     void read_isoraster(const settings::SettingsNode& isoraster_node, const std::unordered_map<std::string, std::size_t>& all_regions);
@@ -21,6 +21,8 @@
 #ifndef IMPACTGEN_IMPACT_H
 #define IMPACTGEN_IMPACT_H
 
+#include "Arena.h"
+#include "TimeVariable.h"
 #include "helpers.h"
 #include "settingsnode.h"
 
@@ -33,6 +35,8 @@ class Impact {
     bool verbose;
     int time_shift;
     std::size_t chunk_size;
+    TimeRange time_range;
+    Arena arena;  // buffers reused across joins
 
     explicit Impact(const settings::SettingsNode& impact_node);
 
@@ -21,25 +21,98 @@
 #ifndef IMPACTGEN_PROXIED_IMPACT_H
 #define IMPACTGEN_PROXIED_IMPACT_H
 
+#include <memory>
 #include <string>
 #include <vector>
+#include "DiskCache.h"
 #include "Forcing.h"
 #include "GeoGrid.h"
+#include "GridCache.h"
+#include "MemoryAccounting.h"
 #include "impacts/GriddedImpact.h"
 #include "nvector.h"
 #include "settingsnode.h"
 
 namespace impactgen {
 
+struct ProxyTotals {
+    std::vector<ForcingType> per_region;     // per isoraster region
+    std::vector<GeoBox<float>> region_boxes;  // bounding box of cells with positive proxy per isoraster region
+    ForcingType sum = 0;                     // over all isoraster regions
+    ForcingType sum_all = 0;                 // including cells not belonging to any isoraster region
+
+    std::size_t memory_size() const { return sizeof(*this) + per_region.capacity() * sizeof(ForcingType) + region_boxes.capacity() * sizeof(GeoBox<float>); }
+    void to_disk_cache(const std::string& source_filename, const std::string& key) const;
+    bool from_disk_cache(const DiskCache::Entry& entry);
+};
+
+// Cells contributing to the used regions, for aggregating directly on the forcing cells (if any of forcing, proxy and isoraster are
+// given as land points only, see read_gathering, or if their resolutions differ, see ConservativeRemapping); no other cells are then
+// read or iterated. Forcing cells shared by several regions appear once per region with the respective fraction of the proxy
+struct RegionPoints {
+    std::vector<std::size_t> cells;  // flattened lat/lon index in forcing grid
+    std::vector<std::size_t> rows;   // position in forcing values as read (row always 0 for gathered forcing)
+    std::vector<std::size_t> cols;
+    std::vector<int> isoraster_indices;
+    std::vector<ForcingType> proxy_values;
+    std::vector<ForcingType> values;  // forcing values of current time step (see gather)
+    std::size_t read_begin = 0;       // range to read along gathered forcing dimension
+    std::size_t read_count = 0;
+
+    std::size_t size() const { return cells.size(); }
+    std::size_t memory_size() const {
+        return (cells.capacity() + rows.capacity() + cols.capacity()) * sizeof(std::size_t) + isoraster_indices.capacity() * sizeof(int)
+               + (proxy_values.capacity() + values.capacity()) * sizeof(ForcingType);
+    }
+
+    // copy forcing values of all points into contiguous values
+    template<typename View>
+    void gather(const View& forcing_values) {
+        const auto& lat_slice = forcing_values.template slice<0>();
+        const auto& lon_slice = forcing_values.template slice<1>();
+        const std::ptrdiff_t lat_stride = lat_slice.stride;
+        const std::ptrdiff_t lon_stride = lon_slice.stride;
+        const auto data = forcing_values.data() + (lat_slice.begin * lat_stride + lon_slice.begin * lon_stride);
+        values.resize(size());
+        for (std::size_t p = 0; p < values.size(); ++p) {
+            values[p] = data[static_cast<std::ptrdiff_t>(rows[p]) * lat_stride + static_cast<std::ptrdiff_t>(cols[p]) * lon_stride];
+        }
+    }
+};
+
 class ProxiedImpact : public GriddedImpact {
   protected:
     bool verbose;
     std::string proxy_filename;
     std::string proxy_varname;
-    GeoGrid<float> proxy_grid;
+    std::string current_proxy_filename;
+    std::shared_ptr<const GridData<ForcingType>> proxy;
     std::vector<ForcingType> total_proxy;
-    nvector::Vector<ForcingType, 2> proxy_values;
+    GeoBox<float> proxy_box;  // bounding box of cells with positive proxy in any of the used regions
+
+    std::string region_points_key;      // inputs region_points_cache has been computed for
+    RegionPoints region_points_cache;  // reused as long as proxy and forcing grid do not change
+    TrackedMemory region_points_memory{MemorySubsystem::PROXY_CACHE};
 
+    // part of forcing_grid covering proxy_box
+    GeoGrid<float> proxy_subgrid(const GeoGrid<float>& forcing_grid, std::size_t& lat_begin, std::size_t& lon_begin) const;
+    // whether to aggregate using region_points rather than iterating over the common grid of forcing, proxy and isoraster
+    bool use_region_points(const GeoGrid<float>& forcing_grid, const std::vector<std::size_t>& forcing_gathering) const;
+    // points for forcing given on forcing_grid (in gathered layout if forcing_gathering is not empty, otherwise as part read_grid
+    // starting at lat_begin and lon_begin), with proxy and isoraster conservatively remapped onto the forcing grid
+    RegionPoints region_points(const GeoGrid<float>& forcing_grid,
+                               const std::vector<std::size_t>& forcing_gathering,
+                               const GeoGrid<float>& read_grid,
+                               std::size_t lat_begin,
+                               std::size_t lon_begin);
+    // calls func(point, isoraster index, proxy value, forcing value) for all points
+    template<typename View, typename Function>
+    static void foreach_point(RegionPoints& points, const View& forcing_values, Function&& func) {
+        points.gather(forcing_values);
+        for (std::size_t p = 0; p < points.size(); ++p) {
+            func(p, points.isoraster_indices[p], points.proxy_values[p], points.values[p]);
+        }
+    }
     explicit ProxiedImpact(const settings::SettingsNode& proxy_node);
     void read_proxy(const std::string& filename, const std::vector<std::string>& all_regions);
 };
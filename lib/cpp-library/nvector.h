@@ -4,9 +4,11 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
+#include <initializer_list>
 #include <iterator>
 #include <stdexcept>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -657,12 +659,460 @@ class Vector : public View<T, dim, typename Storage::iterator> {
         it = std::begin(data_m);
     }
 
+    // replaces the underlying data, which needs to match the given sizes
+    template<typename... Args>
+    void assign(Storage data_p, Args&&... args) {
+        if (detail::multiply_all<std::size_t>(std::forward<Args>(args)...) != data_p.size()) {
+            throw std::runtime_error("wrong size of underlying data");
+        }
+        this->template initialize_sizes<0>(std::forward<Args>(args)...);
+        data_m = std::move(data_p);
+        it = std::begin(data_m);
+    }
+
     void reset(const T& initial_value) { std::fill(std::begin(data_m), std::end(data_m), initial_value); }
 
     Storage& data() { return data_m; }
     const Storage& data() const { return data_m; }
 };
 
+// Lazy element-wise expressions over views (and scalars), e.g. max(a * b + c, 0.0f) or where(a > b, a, b). Operands given as lvalues
+// are referenced, so they need to outlive the expression; temporaries are moved into it. Expressions are evaluated element by element
+// only when assigned (see assign and evaluate) or iterated over (e.g. as arguments of foreach_view), without intermediate arrays.
+
+template<class Function, class... Operands>
+class Expression;
+
+namespace detail {
+
+template<typename T, std::size_t dim, class Iterator, typename Tref>
+std::true_type is_view_helper(const View<T, dim, Iterator, Tref>*);
+std::false_type is_view_helper(...);
+
+template<typename T>
+using is_view = decltype(is_view_helper(std::declval<typename std::decay<T>::type*>()));
+
+template<typename T>
+struct is_expression : std::false_type {};
+template<class Function, class... Operands>
+struct is_expression<Expression<Function, Operands...>> : std::true_type {};
+
+template<typename T>
+using is_node = std::integral_constant<bool, is_view<T>::value || is_expression<typename std::decay<T>::type>::value>;
+
+template<typename T>
+using is_operand = std::integral_constant<bool, is_node<T>::value || std::is_arithmetic<typename std::decay<T>::type>::value>;
+
+template<typename T, std::size_t dim, class Iterator, typename Tref>
+constexpr const View<T, dim, Iterator, Tref>& as_view(const View<T, dim, Iterator, Tref>& view) {
+    return view;
+}
+
+template<typename View, std::size_t dim>
+inline std::ptrdiff_t view_offset(const View& view, const std::array<std::size_t, dim>& pos) {
+    std::ptrdiff_t res = 0;
+    for (std::size_t c = 0; c < dim; ++c) {
+        const auto& slice = view.slice(c);
+        res += (static_cast<std::ptrdiff_t>(pos[c]) + slice.begin) * slice.stride;
+    }
+    return res;
+}
+
+// view as operand, referenced (Stored = const V&) or owned (Stored = V)
+template<typename Stored>
+class ViewOperand {
+  protected:
+    Stored stored;
+    using view_type = typename std::decay<decltype(as_view(std::declval<const typename std::decay<Stored>::type&>()))>::type;
+    const view_type& view() const { return stored; }
+
+  public:
+    static constexpr std::size_t dimensions = view_type::dimensions;
+    using value_type = typename std::remove_cv<typename view_type::type>::type;
+
+    struct Row {
+        typename view_type::iterator_type it;
+        std::ptrdiff_t stride;
+        inline value_type operator[](std::size_t k) const { return it[static_cast<std::ptrdiff_t>(k) * stride]; }
+        inline value_type unit(std::size_t k) const { return it[k]; }
+    };
+
+    template<typename Arg>
+    explicit ViewOperand(Arg&& arg) : stored(std::forward<Arg>(arg)) {}
+    std::size_t size(std::size_t c) const { return view().size(c); }
+    bool unit_stride() const { return view().slice(dimensions - 1).stride == 1; }
+    inline value_type at(const std::array<std::size_t, dimensions>& pos) const { return view().data()[view_offset(view(), pos)]; }
+    inline Row row(const std::array<std::size_t, dimensions>& pos) const {
+        return Row{view().data() + view_offset(view(), pos), view().slice(dimensions - 1).stride};
+    }
+};
+
+// scalar as operand, broadcast to all elements
+template<typename T>
+class ScalarOperand {
+  protected:
+    T value;
+
+  public:
+    static constexpr std::size_t dimensions = 0;
+    using value_type = T;
+
+    struct Row {
+        T value;
+        inline T operator[](std::size_t /* unused */) const { return value; }
+        inline T unit(std::size_t /* unused */) const { return value; }
+    };
+
+    explicit ScalarOperand(T value_p) : value(value_p) {}
+    std::size_t size(std::size_t /* unused */) const { return 0; }
+    constexpr bool unit_stride() const { return true; }
+    template<std::size_t dim>
+    inline T at(const std::array<std::size_t, dim>& /* unused */) const {
+        return value;
+    }
+    template<std::size_t dim>
+    inline Row row(const std::array<std::size_t, dim>& /* unused */) const {
+        return Row{value};
+    }
+};
+
+// type an argument A (as deduced for A&&) is stored as in an expression
+template<typename A>
+using operand_type = typename std::conditional<
+    is_view<A>::value,
+    ViewOperand<typename std::conditional<std::is_lvalue_reference<A>::value, const typename std::decay<A>::type&, typename std::decay<A>::type>::type>,
+    typename std::conditional<is_expression<typename std::decay<A>::type>::value, typename std::decay<A>::type, ScalarOperand<typename std::decay<A>::type>>::
+        type>::type;
+
+template<typename A>
+inline operand_type<A> make_operand(A&& arg) {
+    return operand_type<A>(std::forward<A>(arg));
+}
+
+inline bool all_of(std::initializer_list<bool> values) {
+    return std::all_of(std::begin(values), std::end(values), [](bool v) { return v; });
+}
+
+constexpr std::size_t max_dimensions() { return 0; }
+template<typename... Args>
+constexpr std::size_t max_dimensions(std::size_t d, Args... ds) {
+    return d > max_dimensions(ds...) ? d : max_dimensions(ds...);
+}
+
+constexpr bool dimensions_match(std::size_t /* unused */) { return true; }
+template<typename... Args>
+constexpr bool dimensions_match(std::size_t dim, std::size_t d, Args... ds) {
+    return (d == 0 || d == dim) && dimensions_match(dim, ds...);
+}
+
+struct plus {
+    template<typename A, typename B>
+    inline auto operator()(A a, B b) const -> decltype(a + b) {
+        return a + b;
+    }
+};
+struct minus {
+    template<typename A, typename B>
+    inline auto operator()(A a, B b) const -> decltype(a - b) {
+        return a - b;
+    }
+};
+struct multiplies {
+    template<typename A, typename B>
+    inline auto operator()(A a, B b) const -> decltype(a * b) {
+        return a * b;
+    }
+};
+struct divides {
+    template<typename A, typename B>
+    inline auto operator()(A a, B b) const -> decltype(a / b) {
+        return a / b;
+    }
+};
+struct negate {
+    template<typename A>
+    inline auto operator()(A a) const -> decltype(-a) {
+        return -a;
+    }
+};
+struct less {
+    template<typename A, typename B>
+    inline bool operator()(A a, B b) const {
+        return a < b;
+    }
+};
+struct greater {
+    template<typename A, typename B>
+    inline bool operator()(A a, B b) const {
+        return a > b;
+    }
+};
+struct less_equal {
+    template<typename A, typename B>
+    inline bool operator()(A a, B b) const {
+        return a <= b;
+    }
+};
+struct greater_equal {
+    template<typename A, typename B>
+    inline bool operator()(A a, B b) const {
+        return a >= b;
+    }
+};
+// same semantics as std::min and std::max (in particular for NaN), but for mixed operand types
+struct minimum {
+    template<typename A, typename B>
+    inline typename std::common_type<A, B>::type operator()(A a, B b) const {
+        return b < a ? b : a;
+    }
+};
+struct maximum {
+    template<typename A, typename B>
+    inline typename std::common_type<A, B>::type operator()(A a, B b) const {
+        return a < b ? b : a;
+    }
+};
+struct select {
+    template<typename C, typename A, typename B>
+    inline typename std::common_type<A, B>::type operator()(C condition, A a, B b) const {
+        return condition ? a : b;
+    }
+};
+
+template<typename Expression, std::size_t... Ns>
+inline Vector<typename Expression::value_type, Expression::dimensions> evaluate_helper(const Expression& expression, std::index_sequence<Ns...> /* unused */);
+
+}  // namespace detail
+
+template<class Function, class... Operands>
+class Expression {
+  public:
+    static constexpr std::size_t dimensions = detail::max_dimensions(Operands::dimensions...);
+    using value_type = decltype(std::declval<Function>()(std::declval<typename Operands::value_type>()...));
+
+  protected:
+    static_assert(dimensions > 0, "expression needs a view operand");
+    static_assert(detail::dimensions_match(dimensions, Operands::dimensions...), "operands have different dimensions");
+    Function func;
+    std::tuple<Operands...> operands;
+    std::array<std::size_t, dimensions> sizes;
+
+    template<std::size_t... Ns>
+    inline value_type at_helper(const std::array<std::size_t, dimensions>& pos, std::index_sequence<Ns...> /* unused */) const {
+        return func(std::get<Ns>(operands).at(pos)...);
+    }
+
+    template<typename Operand>
+    static void merge_sizes(const Operand& operand, std::array<std::size_t, dimensions>& sizes_p, bool& found) {
+        if (Operand::dimensions == 0) {
+            return;
+        }
+        for (std::size_t c = 0; c < dimensions; ++c) {
+            if (!found) {
+                sizes_p[c] = operand.size(c);
+            } else if (operand.size(c) != sizes_p[c]) {
+                throw std::runtime_error("views have different sizes");
+            }
+        }
+        found = true;
+    }
+
+    template<std::size_t... Ns>
+    std::array<std::size_t, dimensions> sizes_helper(std::index_sequence<Ns...> /* unused */) const {
+        std::array<std::size_t, dimensions> res{};
+        bool found = false;
+        (void)std::initializer_list<int>{(merge_sizes(std::get<Ns>(operands), res, found), 0)...};
+        return res;
+    }
+
+    template<std::size_t... Ns>
+    bool unit_stride_helper(std::index_sequence<Ns...> /* unused */) const {
+        return detail::all_of({std::get<Ns>(operands).unit_stride()...});
+    }
+
+    template<typename RowType, std::size_t... Ns>
+    inline RowType row_helper(const std::array<std::size_t, dimensions>& pos, std::index_sequence<Ns...> /* unused */) const {
+        return RowType{func, std::make_tuple(std::get<Ns>(operands).row(pos)...)};
+    }
+
+  public:
+    struct Row {
+        Function func;
+        std::tuple<typename Operands::Row...> rows;
+
+        template<std::size_t... Ns>
+        inline value_type get(std::size_t k, std::index_sequence<Ns...> /* unused */) const {
+            return func(std::get<Ns>(rows)[k]...);
+        }
+        template<std::size_t... Ns>
+        inline value_type get_unit(std::size_t k, std::index_sequence<Ns...> /* unused */) const {
+            return func(std::get<Ns>(rows).unit(k)...);
+        }
+        inline value_type operator[](std::size_t k) const { return get(k, std::index_sequence_for<Operands...>()); }
+        inline value_type unit(std::size_t k) const { return get_unit(k, std::index_sequence_for<Operands...>()); }
+    };
+
+    // iterator as used by foreach_view and foreach_view_parallel
+    class iterator {
+      protected:
+        const Expression* expression = nullptr;
+        std::array<Slice, Expression::dimensions> dims;
+        std::array<std::size_t, Expression::dimensions> pos_m;
+        std::size_t total_index = 0;
+        std::size_t end_index = 0;
+
+      public:
+        static const std::size_t dimensions = Expression::dimensions;
+        using type = value_type;
+        using reference_type = value_type;
+
+        iterator(const Expression* expression_p, bool at_end) : expression(expression_p) {
+            for (std::size_t c = 0; c < dimensions; ++c) {
+                dims[c] = Slice{0, expression->sizes[c], 1};
+            }
+            if (at_end) {
+                end_index = detail::foreach_dim<0, dimensions>::end(1, pos_m, dims);
+                total_index = end_index;
+            } else {
+                end_index = detail::foreach_dim<0, dimensions>::begin(1, pos_m, dims);
+            }
+        }
+        inline bool ended() const { return total_index == end_index; }
+        inline std::size_t get_end_index() const { return end_index; }
+        inline std::size_t get_index() const { return total_index; }
+        inline const std::array<std::size_t, dimensions>& pos() const { return pos_m; }
+        inline value_type operator*() const { return expression->at(pos_m); }
+        inline iterator operator++() {
+            detail::foreach_dim<0, dimensions>::increase(pos_m, dims);
+            ++total_index;
+            return *this;
+        }
+        inline iterator operator+(std::size_t i) const {
+            iterator res(*this);
+            if (total_index + i >= end_index) {
+                return iterator(expression, true);
+            }
+            detail::foreach_dim<0, dimensions>::increase(res.pos_m, dims, i);
+            res.total_index += i;
+            return res;
+        }
+        inline bool operator==(const iterator& other) const { return total_index == other.total_index; }
+        inline bool operator!=(const iterator& other) const { return total_index != other.total_index; }
+    };
+
+    Expression(Function func_p, Operands... operands_p)
+        : func(std::move(func_p)), operands(std::move(operands_p)...), sizes(sizes_helper(std::index_sequence_for<Operands...>())) {}
+
+    inline std::size_t size(std::size_t c) const { return sizes.at(c); }
+    // whether all view operands are contiguous along the innermost dimension
+    bool unit_stride() const { return unit_stride_helper(std::index_sequence_for<Operands...>()); }
+    inline value_type at(const std::array<std::size_t, dimensions>& pos) const { return at_helper(pos, std::index_sequence_for<Operands...>()); }
+    inline Row row(const std::array<std::size_t, dimensions>& pos) const { return row_helper<Row>(pos, std::index_sequence_for<Operands...>()); }
+
+    inline iterator begin() const { return iterator(this, false); }
+    inline iterator end() const { return iterator(this, true); }
+};
+
+template<class Function, class... Args>
+inline Expression<Function, detail::operand_type<Args>...> make_expression(Function func, Args&&... args) {
+    return Expression<Function, detail::operand_type<Args>...>(std::move(func), detail::make_operand(std::forward<Args>(args))...);
+}
+
+#define NVECTOR_BINARY_EXPRESSION(NAME, FUNCTION)                                                                                     \
+    template<typename A, typename B,                                                                                                \
+             typename std::enable_if<(detail::is_node<A>::value || detail::is_node<B>::value) && detail::is_operand<A>::value          \
+                                     && detail::is_operand<B>::value>::type* = nullptr>                                              \
+    inline auto NAME(A&& a, B&& b)->decltype(make_expression(detail::FUNCTION(), std::forward<A>(a), std::forward<B>(b))) {          \
+        return make_expression(detail::FUNCTION(), std::forward<A>(a), std::forward<B>(b));                                          \
+    }
+
+NVECTOR_BINARY_EXPRESSION(operator+, plus)
+NVECTOR_BINARY_EXPRESSION(operator-, minus)
+NVECTOR_BINARY_EXPRESSION(operator*, multiplies)
+NVECTOR_BINARY_EXPRESSION(operator/, divides)
+NVECTOR_BINARY_EXPRESSION(operator<, less)
+NVECTOR_BINARY_EXPRESSION(operator>, greater)
+NVECTOR_BINARY_EXPRESSION(operator<=, less_equal)
+NVECTOR_BINARY_EXPRESSION(operator>=, greater_equal)
+NVECTOR_BINARY_EXPRESSION(min, minimum)
+NVECTOR_BINARY_EXPRESSION(max, maximum)
+
+#undef NVECTOR_BINARY_EXPRESSION
+
+template<typename A, typename std::enable_if<detail::is_node<A>::value>::type* = nullptr>
+inline auto operator-(A&& a) -> decltype(make_expression(detail::negate(), std::forward<A>(a))) {
+    return make_expression(detail::negate(), std::forward<A>(a));
+}
+
+// element-wise condition ? a : b
+template<typename C,
+         typename A,
+         typename B,
+         typename std::enable_if<detail::is_node<C>::value && detail::is_operand<A>::value && detail::is_operand<B>::value>::type* = nullptr>
+inline auto where(C&& condition, A&& a, B&& b)
+    -> decltype(make_expression(detail::select(), std::forward<C>(condition), std::forward<A>(a), std::forward<B>(b))) {
+    return make_expression(detail::select(), std::forward<C>(condition), std::forward<A>(a), std::forward<B>(b));
+}
+
+// evaluates expression into target (of the same sizes) in a single pass, row by row along the innermost dimension; target may also
+// be an operand of the expression as long as each of its elements is only read at its own position
+template<typename T, std::size_t dim, class Iterator, typename Tref, class Function, class... Operands>
+inline void assign(View<T, dim, Iterator, Tref>& target, const Expression<Function, Operands...>& expression) {
+    static_assert(dim == Expression<Function, Operands...>::dimensions, "target and expression have different dimensions");
+    std::array<std::size_t, dim> pos{};
+    for (std::size_t c = 0; c < dim; ++c) {
+        if (target.size(c) != expression.size(c)) {
+            throw std::runtime_error("views have different sizes");
+        }
+        if (target.size(c) == 0) {
+            return;
+        }
+    }
+    const auto count = target.size(dim - 1);
+    const std::ptrdiff_t stride = target.slice(dim - 1).stride;
+    const bool contiguous = stride == 1 && expression.unit_stride();
+    while (true) {
+        const auto row = expression.row(pos);
+        auto out = target.data() + detail::view_offset(target, pos);
+        if (contiguous) {
+            // plain loop over contiguous rows, can be vectorized by the compiler
+            for (std::size_t k = 0; k < count; ++k) {
+                out[k] = row.unit(k);
+            }
+        } else {
+            for (std::size_t k = 0; k < count; ++k) {
+                out[static_cast<std::ptrdiff_t>(k) * stride] = row[k];
+            }
+        }
+        // next position of the outer dimensions
+        std::size_t c = dim - 1;
+        while (c > 0 && ++pos[c - 1] == target.size(c - 1)) {
+            pos[c - 1] = 0;
+            --c;
+        }
+        if (c == 0) {
+            return;
+        }
+    }
+}
+
+template<class Function, class... Operands>
+inline Vector<typename Expression<Function, Operands...>::value_type, Expression<Function, Operands...>::dimensions> evaluate(
+    const Expression<Function, Operands...>& expression) {
+    return detail::evaluate_helper(expression, std::make_index_sequence<Expression<Function, Operands...>::dimensions>());
+}
+
+namespace detail {
+
+template<typename Expression, std::size_t... Ns>
+inline Vector<typename Expression::value_type, Expression::dimensions> evaluate_helper(const Expression& expression, std::index_sequence<Ns...> /* unused */) {
+    Vector<typename Expression::value_type, Expression::dimensions> res(typename Expression::value_type(), expression.size(Ns)...);
+    nvector::assign(res, expression);
+    return res;
+}
+
+}  // namespace detail
+
 template<typename... Args, typename Function>
 inline bool foreach_view(const std::tuple<Args...>& views, Function&& func) {
     return detail::foreach_helper<0, std::tuple_size<std::tuple<Args...>>::value, Args...>::foreach_view(std::forward<Function>(func), views);
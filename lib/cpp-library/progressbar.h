@@ -19,14 +19,18 @@
 #define PROGRESSBAR_H
 
 #include <unistd.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _WINDOWS
@@ -342,6 +346,217 @@ class ProgressBar {
     }
 };
 
+class ProgressCounter;
+
+// Background thread reporting all open ProgressCounters, either as progress bars (nested in the order the counters have been opened)
+// or as a stream of JSON lines written to a file descriptor, one object per event:
+//   {"event":"start","id":2,"parent":1,"description":"...","total":100,"time":0.5}
+//   {"event":"progress","id":2,"current":40,"total":100,"rate":80.0,"eta":0.75,"time":1.0}
+//   {"event":"end","id":2,"current":100,"total":100,"time":1.7}
+// with times in seconds since the start of the reporter and rate in steps per second.
+class ProgressReporter {
+  public:
+    enum class Mode { BARS, JSONL, SILENT };
+
+  protected:
+    struct Entry {
+        ProgressCounter* counter;
+        std::size_t id;
+        std::size_t parent;
+        std::size_t last_reported = 0;
+        std::unique_ptr<ProgressBar> bar;
+    };
+
+    std::mutex mutex_m;
+    std::condition_variable wakeup;
+    std::thread thread;
+    bool stopping = false;
+    std::vector<Entry> entries;  // open counters in the order they have been opened
+    std::size_t next_id = 1;
+#ifdef PROGRESSBAR_SILENT
+    Mode mode = Mode::SILENT;
+#else
+    Mode mode = Mode::BARS;
+#endif
+    std::FILE* out = stdout;
+    int fd = 1;
+    std::chrono::milliseconds interval{100};
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    ProgressReporter() = default;
+
+    double seconds() const noexcept { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count(); }
+
+    static void append_json_string(std::string& s, const std::string& str) {
+        s += '"';
+        for (const auto c : str) {
+            if (c == '"' || c == '\\') {
+                s += '\\';
+                s += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);  // NOLINT(hicpp-vararg,cppcoreguidelines-pro-type-vararg)
+                s += escaped;
+            } else {
+                s += c;
+            }
+        }
+        s += '"';
+    }
+
+    void write_line(const std::string& line) noexcept {
+        for (std::size_t written = 0; written < line.size();) {
+            const auto res = ::write(fd, line.data() + written, line.size() - written);
+            if (res <= 0) {
+                return;
+            }
+            written += res;
+        }
+    }
+
+    inline void report(Entry& entry, bool closing);  // needs ProgressCounter, see below
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_m);
+        while (!stopping) {
+            wakeup.wait_for(lock, interval);
+            for (auto& entry : entries) {
+                report(entry, false);
+            }
+        }
+    }
+
+  public:
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+    ~ProgressReporter() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_m);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    static ProgressReporter& instance() {
+        static ProgressReporter reporter;
+        return reporter;
+    }
+
+    // to be set before the first counter is opened; out_p is used for bars, fd_p for JSON lines
+    void configure(Mode mode_p, std::FILE* out_p = stdout, int fd_p = 1, std::size_t interval_ms = 100) {
+        std::lock_guard<std::mutex> guard(mutex_m);
+        mode = mode_p;
+        out = out_p;
+        fd = fd_p;
+        interval = std::chrono::milliseconds(interval_ms);
+    }
+
+    inline std::size_t add(ProgressCounter* counter);
+    inline void remove(ProgressCounter* counter);
+};
+
+// Progress counter for (possibly parallel) loops: increments are single relaxed atomic additions without locking or printing, the
+// counter is reported by the ProgressReporter thread.
+class ProgressCounter {
+    friend class ProgressReporter;
+
+  protected:
+    std::atomic<std::size_t> current{0};
+    bool closed = false;
+    ProgressReporter& reporter;
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+  public:
+    const std::size_t total;
+    const std::string description;
+    const std::size_t id;
+
+    explicit ProgressCounter(std::size_t total_p, std::string description_p = "", ProgressReporter& reporter_p = ProgressReporter::instance())
+        : reporter(reporter_p), total(total_p), description(std::move(description_p)), id(reporter.add(this)) {}
+    ProgressCounter(const ProgressCounter&) = delete;
+    ProgressCounter& operator=(const ProgressCounter&) = delete;
+    ~ProgressCounter() { close(); }
+
+    inline ProgressCounter& operator++() noexcept {
+        current.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+    inline void operator+=(std::size_t n) noexcept { current.fetch_add(n, std::memory_order_relaxed); }
+    std::size_t value() const noexcept { return std::min(current.load(std::memory_order_relaxed), total); }
+
+    // reports the final state (from the calling thread) and stops reporting this counter
+    void close() {
+        if (!closed) {
+            closed = true;
+            reporter.remove(this);
+        }
+    }
+};
+
+void ProgressReporter::report(Entry& entry, bool closing) {
+    const auto current = closing ? entry.counter->total : entry.counter->value();
+    if (mode == Mode::BARS) {
+        if (!entry.bar) {
+            if (closing) {
+                return;  // never shown
+            }
+            entry.bar.reset(new ProgressBar(entry.counter->total, entry.counter->description, entry.parent != 0, out));
+        }
+        *entry.bar = current;
+        if (closing) {
+            entry.bar->close(entry.parent != 0);
+        }
+    } else if (mode == Mode::JSONL && (closing || current != entry.last_reported)) {
+        const auto now = seconds();
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - entry.counter->start_time).count();
+        const auto rate = elapsed > 0 ? current / elapsed : 0;
+        char numbers[160];
+        if (closing) {
+            std::snprintf(numbers, sizeof(numbers), "\"current\":%zu,\"total\":%zu,\"time\":%.3f}\n",  // NOLINT(hicpp-vararg)
+                          current, entry.counter->total, now);
+        } else {
+            std::snprintf(numbers, sizeof(numbers), "\"current\":%zu,\"total\":%zu,\"rate\":%.3f,\"eta\":%.3f,\"time\":%.3f}\n",  // NOLINT(hicpp-vararg)
+                          current, entry.counter->total, rate, rate > 0 ? (entry.counter->total - current) / rate : -1.0, now);
+        }
+        write_line(std::string(closing ? "{\"event\":\"end\",\"id\":" : "{\"event\":\"progress\",\"id\":") + std::to_string(entry.id) + ","
+                   + numbers);
+    }
+    entry.last_reported = current;
+}
+
+std::size_t ProgressReporter::add(ProgressCounter* counter) {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    Entry entry;
+    entry.counter = counter;
+    entry.id = next_id++;
+    entry.parent = entries.empty() ? 0 : entries.back().id;
+    if (mode == Mode::JSONL) {
+        std::string line = "{\"event\":\"start\",\"id\":" + std::to_string(entry.id) + ",\"parent\":" + std::to_string(entry.parent)
+                           + ",\"description\":";
+        append_json_string(line, counter->description);
+        char numbers[80];
+        std::snprintf(numbers, sizeof(numbers), ",\"total\":%zu,\"time\":%.3f}\n", counter->total, seconds());  // NOLINT(hicpp-vararg)
+        write_line(line + numbers);
+    }
+    entries.push_back(std::move(entry));
+    if (!thread.joinable() && mode != Mode::SILENT) {
+        thread = std::thread([this]() { run(); });
+    }
+    return entries.back().id;
+}
+
+void ProgressReporter::remove(ProgressCounter* counter) {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    const auto entry = std::find_if(std::begin(entries), std::end(entries), [counter](const Entry& e) { return e.counter == counter; });
+    if (entry != std::end(entries)) {
+        report(*entry, true);
+        entries.erase(entry);
+    }
+}
+
 }  // namespace progressbar
 
 #endif
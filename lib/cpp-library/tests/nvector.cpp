@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "nvector.h"
+
+int main() {
+    nvector::Vector<float, 2> a(0.f, 3, 4);
+    nvector::Vector<float, 2> b(0.f, 3, 4);
+    nvector::Vector<float, 2> c(0.f, 3, 4);
+    for (std::size_t i = 0; i < 3; ++i) {
+        for (std::size_t j = 0; j < 4; ++j) {
+            a(i, j) = i + j;
+            b(i, j) = static_cast<float>(i) - j;
+        }
+    }
+
+    // contiguous assign with scalar broadcast
+    nvector::assign(c, nvector::max(a * b + 1.f, 0.f));
+    for (std::size_t i = 0; i < 3; ++i) {
+        for (std::size_t j = 0; j < 4; ++j) {
+            if (c(i, j) != std::max(a(i, j) * b(i, j) + 1.f, 0.f)) {
+                std::cerr << "wrong contiguous assign at " << i << "," << j << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // where
+    const auto d = nvector::evaluate(nvector::where(a > b, a - b, -b / 2.f));
+    for (std::size_t i = 0; i < 3; ++i) {
+        for (std::size_t j = 0; j < 4; ++j) {
+            if (d(i, j) != (a(i, j) > b(i, j) ? a(i, j) - b(i, j) : -b(i, j) / 2.f)) {
+                std::cerr << "wrong where at " << i << "," << j << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // transposed view as operand
+    nvector::View<float, 2> t(a.data().begin(), nvector::Slice{0, 4, 1}, nvector::Slice{0, 3, 4});
+    const auto e = nvector::evaluate(t + 0.f);
+    for (std::size_t i = 0; i < 4; ++i) {
+        for (std::size_t j = 0; j < 3; ++j) {
+            if (e(i, j) != a(j, i)) {
+                std::cerr << "wrong transposed view at " << i << "," << j << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // strided subview (every other column) as target
+    nvector::Vector<float, 2> f(-1.f, 3, 4);
+    nvector::View<float, 2> columns(f.data().begin() + 1, nvector::Slice{0, 3, 4}, nvector::Slice{0, 2, 2});
+    nvector::View<float, 2> a_columns(a.data().begin() + 1, nvector::Slice{0, 3, 4}, nvector::Slice{0, 2, 2});
+    nvector::assign(columns, a_columns * 2.f);
+    for (std::size_t i = 0; i < 3; ++i) {
+        for (std::size_t j = 0; j < 4; ++j) {
+            if (f(i, j) != (j % 2 == 1 ? a(i, j) * 2 : -1.f)) {
+                std::cerr << "wrong strided assign at " << i << "," << j << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // expression as foreach_view operand
+    std::size_t count = 0;
+    const bool completed = nvector::foreach_view(nvector::collect(nvector::min(a, b) * 2.f, c), [&](std::size_t i, std::size_t j, float v, float w) {
+        ++count;
+        return v == std::min(a(i, j), b(i, j)) * 2 && w == c(i, j);
+    });
+    if (!completed || count != 12) {
+        std::cerr << "wrong foreach_view over expression" << std::endl;
+        return 1;
+    }
+
+    // in-place assign
+    nvector::assign(a, a * 2.f);
+    if (a(2, 3) != 10) {
+        std::cerr << "wrong in-place assign" << std::endl;
+        return 1;
+    }
+
+    // size mismatch
+    try {
+        nvector::assign(c, e + 1.f);
+        std::cerr << "size mismatch not detected" << std::endl;
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    std::cerr << "done" << std::endl;
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "progressbar.h"
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "jsonl") == 0) {
+        progressbar::ProgressReporter::instance().configure(progressbar::ProgressReporter::Mode::JSONL);
+    }
+    const std::size_t n = 10;
+    const std::size_t m = 1000;
+    progressbar::ProgressCounter outer(n, "outer");
+    for (std::size_t i = 0; i < n; ++i) {
+        progressbar::ProgressCounter inner(4 * m, "inner");
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&inner]() {
+                for (std::size_t j = 0; j < m; ++j) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    ++inner;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        if (inner.value() != 4 * m) {
+            std::cerr << "wrong count " << inner.value() << std::endl;
+            return 1;
+        }
+        inner.close();
+        ++outer;
+    }
+    outer.close();
+    std::cerr << "done" << std::endl;
+    return 0;
+}
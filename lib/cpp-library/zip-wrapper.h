@@ -51,7 +51,7 @@ class streambuf : public std::streambuf {
             return traits_type::to_int_type(*gptr());
         }
         char* start = &buffer[0];
-        const size_t n = zip_fread(m, start, buffer.size());
+        const zip_int64_t n = zip_fread(m, start, buffer.size());
         if (n < 0) {
             throw exception("could not read from zipped file");
         }
@@ -68,11 +68,16 @@ class ifstream : public std::istream {
     zip_file* m;
 
   public:
-    explicit ifstream(zip_file* file) : m(file), std::istream(new streambuf(file)){};
-    ifstream(ifstream&& other) = default;
+    explicit ifstream(zip_file* file) : std::istream(new streambuf(file)), m(file){};
+    ifstream(ifstream&& other) noexcept : std::istream(other.rdbuf()), m(other.m) {
+        other.rdbuf(nullptr);
+        other.m = nullptr;
+    };
     virtual ~ifstream() {
         delete rdbuf();
-        zip_fclose(m);
+        if (m) {
+            zip_fclose(m);
+        }
     };
 };
 
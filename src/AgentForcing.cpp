@@ -19,6 +19,7 @@
 */
 
 #include "AgentForcing.h"
+#include <algorithm>
 #include <memory>
 #include <stdexcept>
 
@@ -36,32 +37,131 @@ AgentForcing::AgentForcing(const std::vector<std::string>& sectors_p, const std:
     data = std::vector<ForcingType>(sectors->size() * regions->size(), 1);
 }
 
-void AgentForcing::include(const AgentForcing& other, ForcingCombination combination) {
+void AgentForcing::check_related(const AgentForcing& other) const {
     if (sectors.get() != other.sectors.get() || regions.get() != other.regions.get()) {
         throw std::runtime_error("Forcings are not related");
     }
-    switch (combination) {
-        case ForcingCombination::ADD:
-            for (std::size_t i = 0; i < data.size(); ++i) {
-                data[i] = std::max(data[i] + other.data[i] - 1, ForcingType(0.0));
+}
+
+void AgentForcing::include(const AgentForcing& other, ForcingCombination combination) {
+    if (quantized != other.quantized) {
+        include(std::vector<const AgentForcing*>{&other}, combination);  // needs conversion
+        return;
+    }
+    // common case of same representation without any allocations (called for every time step when including series)
+    check_related(other);
+    if (quantized) {
+        const QuantizedForcingType* operand = other.quantized_data.data();
+        combine(quantized_data.data(), &operand, 1, quantized_data.size(), combination);
+    } else {
+        const ForcingType* operand = other.data.data();
+        combine(data.data(), &operand, 1, data.size(), combination);
+    }
+}
+
+void AgentForcing::include(const std::vector<const AgentForcing*>& others, ForcingCombination combination) {
+    std::vector<AgentForcing> converted;  // operands in the other representation
+    converted.reserve(others.size());
+    std::vector<const AgentForcing*> operands;
+    operands.reserve(others.size());
+    for (const auto other : others) {
+        check_related(*other);
+        if (quantized == other->quantized) {
+            operands.push_back(other);
+        } else {
+            converted.push_back(*other);
+            if (quantized) {
+                converted.back().quantize();
+            } else {
+                converted.back().dequantize();
             }
-            break;
-        case ForcingCombination::MAX:
-            for (std::size_t i = 0; i < data.size(); ++i) {
-                data[i] = std::max(data[i], other.data[i]);
+            operands.push_back(&converted.back());
+        }
+    }
+    if (quantized) {
+        std::vector<const QuantizedForcingType*> operands_data(operands.size());
+        std::transform(std::begin(operands), std::end(operands), std::begin(operands_data),
+                       [](const AgentForcing* f) { return &f->quantized_data[0]; });
+        combine(&quantized_data[0], &operands_data[0], operands_data.size(), quantized_data.size(), combination);
+    } else {
+        std::vector<const ForcingType*> operands_data(operands.size());
+        std::transform(std::begin(operands), std::end(operands), std::begin(operands_data), [](const AgentForcing* f) { return &f->data[0]; });
+        combine(&data[0], &operands_data[0], operands_data.size(), data.size(), combination);
+    }
+}
+
+void AgentForcing::aggregate(const std::vector<const AgentForcing*>& operands, std::size_t step_count, ForcingAggregation aggregation) {
+    if (operands.empty()) {
+        throw std::runtime_error("Nothing to aggregate");
+    }
+    *this = *operands.front();
+    dequantize();
+    const std::vector<const AgentForcing*> others(std::begin(operands) + 1, std::end(operands));
+    const bool has_missing = step_count > operands.size();
+    switch (aggregation) {
+        case ForcingAggregation::MEAN: {
+            std::vector<ForcingType> decoded;
+            for (const auto other : others) {
+                const ForcingType* values;
+                if (other->quantized) {
+                    decoded.resize(other->quantized_data.size());
+                    quantization::decode(other->quantized_data.data(), decoded.data(), decoded.size());
+                    values = decoded.data();
+                } else {
+                    values = other->data.data();
+                }
+                for (std::size_t i = 0; i < data.size(); ++i) {
+                    data[i] += values[i];
+                }
+            }
+            const auto count = std::max(step_count, operands.size());
+            const auto missing = static_cast<ForcingType>(count - operands.size());
+            for (auto& d : data) {
+                d = (d + missing) / count;
+            }
+        } break;
+        case ForcingAggregation::MIN:
+            if (!others.empty()) {
+                include(others, ForcingCombination::MIN);
+            }
+            if (has_missing) {
+                std::transform(std::begin(data), std::end(data), std::begin(data), [](ForcingType d) { return std::min(d, ForcingType(1.0)); });
             }
             break;
-        case ForcingCombination::MIN:
-            for (std::size_t i = 0; i < data.size(); ++i) {
-                data[i] = std::min(data[i], other.data[i]);
+        case ForcingAggregation::MAX:
+            if (!others.empty()) {
+                include(others, ForcingCombination::MAX);
+            }
+            if (has_missing) {
+                std::transform(std::begin(data), std::end(data), std::begin(data), [](ForcingType d) { return std::max(d, ForcingType(1.0)); });
             }
             break;
-        case ForcingCombination::MULT:
-            for (std::size_t i = 0; i < data.size(); ++i) {
-                data[i] = data[i] * other.data[i];
+        case ForcingAggregation::PRODUCT:
+            if (!others.empty()) {
+                include(others, ForcingCombination::MULT);
             }
             break;
     }
 }
 
+void AgentForcing::quantize() {
+    if (quantized) {
+        return;
+    }
+    quantized_data.resize(data.size());
+    quantization::encode(&data[0], &quantized_data[0], data.size());
+    std::vector<ForcingType>().swap(data);
+    quantized = true;
+}
+
+void AgentForcing::dequantize() {
+    if (!quantized) {
+        return;
+    }
+    data.resize(quantized_data.size());
+    quantization::decode(&quantized_data[0], &data[0], quantized_data.size());
+    std::vector<QuantizedForcingType>().swap(quantized_data);
+    quantized = false;
+}
+
 }  // namespace impactgen
@@ -0,0 +1,81 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Calendar.h"
+#include <stdexcept>
+
+namespace impactgen {
+
+namespace calendar {
+
+static_assert(days_from_date(Calendar::STANDARD, 1970, 1, 1) == 0, "wrong epoch");
+static_assert(days_from_date(Calendar::STANDARD, 1582, 10, 4) + 1 == days_from_date(Calendar::STANDARD, 1582, 10, 15), "wrong Gregorian reform");
+static_assert(days_from_date(Calendar::PROLEPTIC_GREGORIAN, 2000, 3, 1) - days_from_date(Calendar::PROLEPTIC_GREGORIAN, 2000, 2, 28) == 2, "wrong leap year");
+
+bool exists(Calendar calendar, const Date& date) {
+    const auto check = date_from_days(calendar, days_from_date(calendar, date.year, date.month, date.day));
+    return check.year == date.year && check.month == date.month && check.day == date.day;
+}
+
+std::time_t convert(Calendar from, Calendar to, std::time_t time) {
+    if (from == to) {
+        return time;
+    }
+    const auto days = detail::floor_div(time, seconds_per_day);
+    auto date = date_from_days(from, days);
+    while (date.day > 1 && !exists(to, date)) {
+        --date.day;
+    }
+    return days_from_date(to, date.year, date.month, date.day) * seconds_per_day + (time - days * seconds_per_day);
+}
+
+Calendar from_name(const std::string& name) {
+    if (name == "standard" || name == "gregorian") {
+        return Calendar::STANDARD;
+    }
+    if (name == "proleptic_gregorian") {
+        return Calendar::PROLEPTIC_GREGORIAN;
+    }
+    if (name == "noleap" || name == "365_day") {
+        return Calendar::NOLEAP;
+    }
+    if (name == "360_day") {
+        return Calendar::DAY360;
+    }
+    throw std::runtime_error("Unsupported calendar '" + name + "'");
+}
+
+const char* name(Calendar calendar) {
+    switch (calendar) {
+        case Calendar::STANDARD:
+            return "standard";
+        case Calendar::PROLEPTIC_GREGORIAN:
+            return "proleptic_gregorian";
+        case Calendar::NOLEAP:
+            return "noleap";
+        case Calendar::DAY360:
+            return "360_day";
+    }
+    return "standard";
+}
+
+}  // namespace calendar
+
+}  // namespace impactgen
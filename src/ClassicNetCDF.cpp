@@ -0,0 +1,298 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClassicNetCDF.h"
+#include <fstream>
+#include <utility>
+
+namespace impactgen {
+
+static constexpr std::uint32_t tag_dimension = 0x0A;
+static constexpr std::uint32_t tag_variable = 0x0B;
+static constexpr std::uint32_t tag_attribute = 0x0C;
+static constexpr std::uint32_t streaming = 0xFFFFFFFF;
+
+struct ClassicNetCDF::Parser {
+    const ClassicNetCDF& file;
+    const char* pos;
+    const char* end;
+
+    void check(std::size_t size) const {
+        if (static_cast<std::size_t>(end - pos) < size) {
+            throw std::runtime_error(file.filename + ": Unexpected end of header");
+        }
+    }
+    std::uint32_t read_int() {
+        check(4);
+        const auto res = detail::from_big_endian<std::uint32_t>(pos);
+        pos += 4;
+        return res;
+    }
+    std::uint64_t read_int64() {
+        check(8);
+        const auto res = detail::from_big_endian<std::uint64_t>(pos);
+        pos += 8;
+        return res;
+    }
+    std::uint64_t read_non_neg() { return file.format == 5 ? read_int64() : read_int(); }
+    std::uint64_t read_offset() { return file.format == 1 ? read_int() : read_int64(); }
+    const char* read_padded(std::size_t size) {
+        const auto padded_size = (size + 3) / 4 * 4;
+        check(padded_size);
+        const auto res = pos;
+        pos += padded_size;
+        return res;
+    }
+    std::string read_name() {
+        const auto size = read_non_neg();
+        return std::string(read_padded(size), size);
+    }
+    std::size_t read_list(std::uint32_t expected_tag) {
+        const auto tag = read_int();
+        const auto count = read_non_neg();
+        if (tag == 0 && count == 0) {
+            return 0;
+        }
+        if (tag != expected_tag) {
+            throw std::runtime_error(file.filename + ": Invalid header");
+        }
+        return count;
+    }
+    std::vector<Attribute> read_attributes() {
+        std::vector<Attribute> res(read_list(tag_attribute));
+        for (auto& attribute : res) {
+            attribute.name = read_name();
+            attribute.type = static_cast<Type>(read_int());
+            attribute.count = read_non_neg();
+            attribute.data = read_padded(attribute.count * type_size(attribute.type));
+        }
+        return res;
+    }
+};
+
+bool ClassicNetCDF::is_classic(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    char magic[4];
+    if (!in.read(magic, 4)) {
+        return false;
+    }
+    return is_classic(magic, 4);
+}
+
+bool ClassicNetCDF::is_classic(const char* data_p, std::size_t size_p) {
+    return size_p >= 4 && data_p[0] == 'C' && data_p[1] == 'D' && data_p[2] == 'F' && (data_p[3] == 1 || data_p[3] == 2 || data_p[3] == 5);
+}
+
+std::size_t ClassicNetCDF::type_size(Type type) {
+    switch (type) {
+        case Type::BYTE:
+        case Type::CHAR:
+        case Type::UBYTE:
+            return 1;
+        case Type::SHORT:
+        case Type::USHORT:
+            return 2;
+        case Type::INT:
+        case Type::FLOAT:
+        case Type::UINT:
+            return 4;
+        case Type::DOUBLE:
+        case Type::INT64:
+        case Type::UINT64:
+            return 8;
+    }
+    throw std::runtime_error("Unknown netCDF type");
+}
+
+ClassicNetCDF::ClassicNetCDF(std::string filename_p) : filename(std::move(filename_p)) {
+    file.reset(new MappedFile(filename));
+    data = file->data();
+    size = file->size();
+    parse();
+}
+
+ClassicNetCDF::ClassicNetCDF(std::string filename_p, const char* data_p, std::size_t size_p) : filename(std::move(filename_p)), data(data_p), size(size_p) {
+    parse();
+}
+
+void ClassicNetCDF::parse() {
+    if (!is_classic(data, size)) {
+        throw std::runtime_error(filename + ": Not a netCDF classic file");
+    }
+    format = data[3];
+    Parser parser{*this, data + 4, data + size};
+
+    const auto numrecs = parser.read_non_neg();
+    if (format != 5 && numrecs == streaming) {
+        throw std::runtime_error(filename + ": Streaming netCDF files not supported");
+    }
+    record_count_m = numrecs;
+
+    dimensions_m.resize(parser.read_list(tag_dimension));
+    for (auto& dimension : dimensions_m) {
+        dimension.name = parser.read_name();
+        dimension.size = parser.read_non_neg();
+    }
+
+    attributes_m = parser.read_attributes();
+
+    variables_m.resize(parser.read_list(tag_variable));
+    std::size_t record_variables = 0;
+    for (auto& variable : variables_m) {
+        variable.name = parser.read_name();
+        variable.dimensions.resize(parser.read_non_neg());
+        for (auto& dimension : variable.dimensions) {
+            dimension = parser.read_non_neg();
+            if (dimension >= dimensions_m.size()) {
+                throw std::runtime_error(filename + " - " + variable.name + ": Invalid dimension");
+            }
+        }
+        variable.attributes = parser.read_attributes();
+        variable.type = static_cast<Type>(parser.read_int());
+        parser.read_non_neg();  // vsize, recalculated below as it is not reliable for large variables
+        variable.begin = parser.read_offset();
+        variable.is_record = !variable.dimensions.empty() && dimensions_m[variable.dimensions[0]].size == 0;
+        variable.size = type_size(variable.type);
+        for (std::size_t i = variable.is_record ? 1 : 0; i < variable.dimensions.size(); ++i) {
+            variable.size *= dimensions_m[variable.dimensions[i]].size;
+        }
+        if (variable.is_record) {
+            ++record_variables;
+            record_size += (variable.size + 3) / 4 * 4;
+        }
+    }
+    if (record_variables == 1) {
+        // no padding if there is only one record variable
+        for (const auto& variable : variables_m) {
+            if (variable.is_record) {
+                record_size = variable.size;
+            }
+        }
+    }
+
+    for (const auto& variable : variables_m) {
+        const auto extent = variable.is_record ? (record_count_m == 0 ? 0 : (record_count_m - 1) * record_size + variable.size) : variable.size;
+        if (variable.begin + extent > size) {
+            throw std::runtime_error(filename + " - " + variable.name + ": File truncated");
+        }
+    }
+}
+
+const ClassicNetCDF::Variable* ClassicNetCDF::variable(const std::string& name) const {
+    for (const auto& variable : variables_m) {
+        if (variable.name == name) {
+            return &variable;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t ClassicNetCDF::dimension_size(const Variable& variable, std::size_t i) const {
+    const auto& dimension = dimensions_m[variable.dimensions.at(i)];
+    return dimension.size == 0 ? record_count_m : dimension.size;
+}
+
+const char* ClassicNetCDF::element_data(const Variable& variable, const std::vector<std::size_t>& indices) const {
+    std::uint64_t offset = variable.begin;
+    std::size_t first = 0;
+    if (variable.is_record) {
+        if (indices.empty()) {
+            throw std::runtime_error(filename + " - " + variable.name + ": Missing record index");
+        }
+        offset += indices[0] * record_size;
+        first = 1;
+    }
+    std::uint64_t index = 0;
+    for (std::size_t i = first; i < variable.dimensions.size(); ++i) {
+        const auto size = dimension_size(variable, i);
+        const auto value = i < indices.size() ? indices[i] : 0;
+        if (value >= size) {
+            throw std::runtime_error(filename + " - " + variable.name + ": Index out of bounds");
+        }
+        index = index * size + value;
+    }
+    if (variable.is_record && indices[0] >= record_count_m) {
+        throw std::runtime_error(filename + " - " + variable.name + ": Index out of bounds");
+    }
+    return data + offset + index * type_size(variable.type);
+}
+
+void ClassicNetCDF::slice_dimensions(const Variable& variable,
+                                     const std::vector<std::size_t>& outer_indices,
+                                     std::size_t& lat_size,
+                                     std::size_t& lon_size) const {
+    const auto n = variable.dimensions.size();
+    if (n >= 2 && outer_indices.size() == n - 2) {
+        lat_size = dimension_size(variable, n - 2);
+        lon_size = dimension_size(variable, n - 1);
+    } else if (n >= 1 && outer_indices.size() == n - 1) {
+        lat_size = 1;
+        lon_size = dimension_size(variable, n - 1);
+    } else {
+        throw std::runtime_error(filename + " - " + variable.name + ": Unexpected dimensions");
+    }
+}
+
+template<typename Word>
+static void copy_from_big_endian(const char* in, char* out, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto v = detail::from_big_endian<Word>(in + i * sizeof(Word));
+        std::memcpy(out + i * sizeof(Word), &v, sizeof(Word));
+    }
+}
+
+void ClassicNetCDF::read_slice(const Variable& variable,
+                               const std::vector<std::size_t>& outer_indices,
+                               std::size_t lat_begin,
+                               std::size_t lat_count,
+                               std::size_t lon_begin,
+                               std::size_t lon_count,
+                               char* out) const {
+    std::size_t lat_size;
+    std::size_t lon_size;
+    slice_dimensions(variable, outer_indices, lat_size, lon_size);
+    if (lat_begin + lat_count > lat_size || lon_begin + lon_count > lon_size) {
+        throw std::runtime_error(filename + " - " + variable.name + ": Index out of bounds");
+    }
+    const auto value_size = type_size(variable.type);
+    const char* in = element_data(variable, outer_indices) + (lat_begin * lon_size + lon_begin) * value_size;
+    for (std::size_t lat = 0; lat < lat_count; ++lat) {
+        char* row = out + lat * lon_count * value_size;
+        switch (value_size) {
+            case 1:
+                std::memcpy(row, in, lon_count);
+                break;
+            case 2:
+                copy_from_big_endian<std::uint16_t>(in, row, lon_count);
+                break;
+            case 4:
+                copy_from_big_endian<std::uint32_t>(in, row, lon_count);
+                break;
+            case 8:
+                copy_from_big_endian<std::uint64_t>(in, row, lon_count);
+                break;
+            default:
+                throw std::runtime_error(filename + " - " + variable.name + ": Unexpected type");
+        }
+        in += lon_size * value_size;
+    }
+}
+
+}  // namespace impactgen
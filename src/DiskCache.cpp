@@ -0,0 +1,184 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "DiskCache.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "InputFile.h"
+
+namespace impactgen {
+
+static constexpr char cache_magic[8] = {'I', 'M', 'P', 'G', 'E', 'N', 'C', '\0'};
+static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+std::uint64_t fnv1a_hash(const char* data, std::size_t size, std::uint64_t hash) {
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+DiskCache& DiskCache::instance() {
+    static DiskCache cache;
+    return cache;
+}
+
+void DiskCache::set_directory(std::string directory_p, bool verify_hash_p) {
+    directory = std::move(directory_p);
+    verify_hash = verify_hash_p;
+    if (!directory.empty()) {
+        mkdir(directory.c_str(), 0777);  // fails if existing
+    }
+}
+
+std::string DiskCache::cache_filename(std::uint64_t key_hash) const {
+    std::ostringstream ss;
+    ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key_hash << ".cache";
+    return ss.str();
+}
+
+std::string DiskCache::identity(const std::string& source_filename, const std::string& key) {
+    std::string res = source_filename;
+    res.push_back('\0');
+    res.append(key);
+    return res;
+}
+
+bool DiskCache::fill_source_info(const std::string& source_filename, Header& header) const {
+    const auto path = InputFile::physical_path(source_filename);  // for archive members, the archive as a whole is checked
+    struct stat file_stat = {};
+    if (stat(path.c_str(), &file_stat) != 0) {
+        return false;
+    }
+    header.source_size = file_stat.st_size;
+    header.source_mtime = file_stat.st_mtime;
+    header.source_hash = 0;
+    if (verify_hash) {
+        MappedFile source(path);
+        header.source_hash = fnv1a_hash(source.data(), source.size());
+    }
+    return true;
+}
+
+std::unique_ptr<DiskCache::Entry> DiskCache::load(const std::string& source_filename, const std::string& key) const {
+    if (!enabled()) {
+        return nullptr;
+    }
+    const auto key_identity = identity(source_filename, key);
+    const auto key_hash = fnv1a_hash(key_identity.c_str(), key_identity.size());
+    const auto filename = cache_filename(key_hash);
+    if (access(filename.c_str(), R_OK) != 0) {
+        return nullptr;
+    }
+    std::unique_ptr<Entry> res(new Entry());
+    res->file = std::make_shared<MappedFile>(filename, MappedFile::Mode::COPY_ON_WRITE);
+    if (res->file->size() < sizeof(Header)) {
+        return nullptr;
+    }
+    Header header;
+    std::memcpy(&header, res->file->data(), sizeof(Header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || header.version != version || header.byte_order != byte_order_mark
+        || header.key_hash != key_hash || header.section_count > max_sections) {
+        return nullptr;
+    }
+    if (header.identity_size != key_identity.size() || res->file->size() < sizeof(Header) + key_identity.size()
+        || std::memcmp(res->file->data() + sizeof(Header), key_identity.data(), key_identity.size()) != 0) {
+        return nullptr;  // hash collision
+    }
+    Header source_header = {};
+    if (!fill_source_info(source_filename, source_header) || source_header.source_size != header.source_size
+        || source_header.source_mtime != header.source_mtime || (verify_hash && source_header.source_hash != header.source_hash)) {
+        return nullptr;  // outdated
+    }
+    for (std::size_t i = 0; i < header.section_count; ++i) {
+        if (header.section_offsets[i] + header.section_sizes[i] > res->file->size()) {
+            return nullptr;  // truncated
+        }
+        res->sections.push_back(Section{res->file->data() + header.section_offsets[i], header.section_sizes[i]});
+    }
+    return res;
+}
+
+void DiskCache::store(const std::string& source_filename, const std::string& key, const std::vector<Section>& sections) const {
+    if (!enabled()) {
+        return;
+    }
+    if (sections.size() > max_sections) {
+        throw std::runtime_error("Too many sections for cache");
+    }
+    const auto key_identity = identity(source_filename, key);
+    Header header = {};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.key_hash = fnv1a_hash(key_identity.c_str(), key_identity.size());
+    header.identity_size = key_identity.size();
+    if (!fill_source_info(source_filename, header)) {
+        return;
+    }
+    header.section_count = sections.size();
+    std::uint64_t offset = (sizeof(Header) + key_identity.size() + alignment - 1) / alignment * alignment;
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        header.section_offsets[i] = offset;
+        header.section_sizes[i] = sections[i].size;
+        offset += (sections[i].size + alignment - 1) / alignment * alignment;
+    }
+
+    // write to temporary file first and move in place, so that concurrent runs never see partial files; as the cache is optional,
+    // failures (e.g. read-only or full cache directory) only give a warning
+    const auto filename = cache_filename(header.key_hash);
+    const auto tmp_filename = filename + "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp_filename, std::ios::binary);
+        if (!out) {
+            std::cerr << "Warning: " << tmp_filename << ": Could not create cache file" << std::endl;
+            return;
+        }
+        const std::vector<char> padding(alignment, 0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(key_identity.data(), key_identity.size());
+        std::uint64_t pos = sizeof(Header) + key_identity.size();
+        for (std::size_t i = 0; i < sections.size(); ++i) {
+            out.write(&padding[0], header.section_offsets[i] - pos);
+            out.write(static_cast<const char*>(sections[i].data), sections[i].size);
+            pos = header.section_offsets[i] + sections[i].size;
+        }
+        out.close();
+        if (!out) {
+            std::remove(tmp_filename.c_str());
+            std::cerr << "Warning: " << tmp_filename << ": Could not write cache file" << std::endl;
+            return;
+        }
+    }
+    if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmp_filename.c_str());
+        std::cerr << "Warning: " << filename << ": Could not write cache file" << std::endl;
+    }
+}
+
+}  // namespace impactgen
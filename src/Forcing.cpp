@@ -0,0 +1,54 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Forcing.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace impactgen {
+namespace quantization {
+
+// all loops below are kept branch-free so that they get auto-vectorized
+
+void encode(const ForcingType* in, QuantizedForcingType* out, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        // argument order of min/max maps NaN to 0, which is then replaced by fill_value
+        const auto v = std::min(std::max(ForcingType(0.0), in[i]), ForcingType(1.0));
+        const auto q = static_cast<QuantizedForcingType>(v * max_value + ForcingType(0.5));
+        out[i] = in[i] != in[i] ? fill_value : q;
+    }
+}
+
+void decode(const QuantizedForcingType* in, ForcingType* out, std::size_t size) {
+    static_assert(sizeof(ForcingType) == sizeof(std::uint32_t), "expecting single precision forcing values");
+    for (std::size_t i = 0; i < size; ++i) {
+        // fill_value becomes NaN by setting all exponent bits (and the quiet bit); done on the bit pattern as a select on float values
+        // does not get vectorized
+        const ForcingType v = in[i] * scale_factor;
+        std::uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        bits |= -static_cast<std::uint32_t>(in[i] == fill_value) & UINT32_C(0x7fc00000);
+        std::memcpy(&out[i], &bits, sizeof(bits));
+    }
+}
+
+}  // namespace quantization
+}  // namespace impactgen
@@ -0,0 +1,170 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "ForcingReader.h"
+#include <algorithm>
+
+namespace impactgen {
+
+ForcingReader::ForcingReader(const InputFile& file,
+                             const netCDF::NcVar& variable_p,
+                             const GeoGrid<float>& grid,
+                             std::size_t chunk_size_p,
+                             const GeoGrid<float>& read_grid,
+                             std::size_t lat_begin_p,
+                             std::size_t lon_begin_p,
+                             Arena* arena_p)
+    : variable(variable_p),
+      lat_begin(lat_begin_p),
+      lat_count(read_grid.lat_count),
+      lon_begin(lon_begin_p),
+      lon_count(read_grid.lon_count),
+      chunk_size(std::max<std::size_t>(chunk_size_p, 1)),
+      packing(variable_p),
+      arena(arena_p) {
+    if (!grid.is_canonical()) {
+        remapped = true;
+        lat_reversed = grid.lat_stepsize < 0;
+        lon_reversed = grid.lon_stepsize < 0;
+        stored_lat_begin = lat_reversed ? grid.lat_count - lat_begin - lat_count : lat_begin;
+        // columns in ascending order of longitude, split where the rotation wraps around
+        const auto ascending_begin = (lon_begin + grid.lon_rotation) % grid.lon_count;
+        const auto first_count = std::min(lon_count, grid.lon_count - ascending_begin);
+        lon_segments.push_back(Segment{ascending_begin, first_count, 0});
+        if (first_count < lon_count) {
+            lon_segments.push_back(Segment{0, lon_count - first_count, first_count});
+        }
+        if (lon_reversed) {
+            for (auto& segment : lon_segments) {
+                segment.stored_begin = grid.lon_count - segment.stored_begin - segment.count;
+            }
+        }
+    }
+    open(file);
+}
+
+ForcingReader::ForcingReader(
+    const InputFile& file, const netCDF::NcVar& variable_p, std::size_t begin, std::size_t count, std::size_t chunk_size_p, Arena* arena_p)
+    : variable(variable_p),
+      lat_begin(0),
+      lat_count(1),
+      lon_begin(begin),
+      lon_count(count),
+      gathered(true),
+      chunk_size(std::max<std::size_t>(chunk_size_p, 1)),
+      packing(variable_p),
+      arena(arena_p) {
+    open(file);
+}
+
+ForcingReader::~ForcingReader() {
+    if (arena) {
+        arena->give_back("chunk", std::move(chunk_buffer));
+        arena->give_back("segment", std::move(segment_buffer));
+        arena->give_back("raw", std::move(raw_buffer));
+    }
+}
+
+template<typename T>
+static void take_buffer(Arena* arena, const char* name, std::vector<T>& buffer, std::size_t size) {
+    if (arena) {
+        buffer = arena->take<T>(name, size);
+    } else {
+        buffer.resize(size);
+    }
+}
+
+void ForcingReader::open(const InputFile& file) {
+    filename = file.name();
+    if (file.in_memory() ? ClassicNetCDF::is_classic(file.data(), file.size()) : ClassicNetCDF::is_classic(file.name())) {
+        classic_file.reset(file.in_memory() ? new ClassicNetCDF(file.name(), file.data(), file.size()) : new ClassicNetCDF(file.name()));
+        classic_variable = classic_file->variable(variable.getName());
+        if (classic_variable) {
+            const auto n = classic_variable->dimensions.size();
+            if (classic_variable->type != packing.raw_type() || n < (gathered ? 1 : 2)
+                || (!gathered && classic_file->dimension_size(*classic_variable, n - 2) < lat_begin + lat_count)
+                || classic_file->dimension_size(*classic_variable, n - 1) < lon_begin + lon_count) {
+                classic_variable = nullptr;  // read through netCDF library instead
+            }
+        }
+    }
+    if (!classic_variable) {
+        classic_file.reset();
+    }
+    {
+        // shrink chunks to the memory available (buffers per slice: chunk, segment and raw buffer at most)
+        const auto slice_size = lat_count * lon_count * (2 * sizeof(ForcingType) + packing.raw_size());
+        chunk_size = MemoryAccounting::instance().fitting_count(chunk_size, slice_size);
+    }
+    if (remapped) {
+        // segments are read chunk-wise in the variable's own type, unpacked and then placed in the chunk buffer
+        take_buffer(arena, "chunk", chunk_buffer, chunk_size * lat_count * lon_count);
+        take_buffer(arena, "segment", segment_buffer, chunk_size * lat_count * lon_count);
+        take_buffer(arena, "raw", raw_buffer, (segment_buffer.size() * packing.raw_size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    } else if (!packing.is_trivial()) {
+        // mapped slices are unpacked one at a time
+        const auto buffer_size = (classic_variable ? 1 : chunk_size) * lat_count * lon_count;
+        take_buffer(arena, "chunk", chunk_buffer, buffer_size);
+        take_buffer(arena, "raw", raw_buffer, (buffer_size * packing.raw_size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    } else if (!classic_variable) {
+        take_buffer(arena, "chunk", chunk_buffer, chunk_size * lat_count * lon_count);
+    }
+    buffer_memory.set(chunk_buffer.capacity() * sizeof(ForcingType) + segment_buffer.capacity() * sizeof(ForcingType)
+                      + raw_buffer.capacity() * sizeof(std::uint64_t));
+}
+
+void ForcingReader::read_remapped(const std::vector<std::size_t>& outer_indices, std::size_t first_index, std::size_t chunk_count) {
+    IMPACTGEN_PROFILE("read");
+    IMPACTGEN_PROFILE_BYTES(filename, chunk_count * lat_count * lon_count * packing.raw_size());
+    Metrics::instance().add_read(chunk_count * lat_count * lon_count, chunk_count * lat_count * lon_count * packing.raw_size());
+    for (const auto& segment : lon_segments) {
+        const auto segment_size = lat_count * segment.count;
+        if (classic_variable) {
+            std::vector<std::size_t> indices(outer_indices);
+            indices.push_back(0);
+            for (std::size_t chunk_pos = 0; chunk_pos < chunk_count; ++chunk_pos) {
+                indices.back() = first_index + chunk_pos;
+                classic_file->read_slice(*classic_variable, indices, stored_lat_begin, lat_count, segment.stored_begin, segment.count,
+                                         reinterpret_cast<char*>(&raw_buffer[0]) + chunk_pos * segment_size * packing.raw_size());
+            }
+        } else {
+            std::vector<std::size_t> indices(outer_indices);
+            indices.insert(std::end(indices), {first_index, stored_lat_begin, segment.stored_begin});
+            std::vector<std::size_t> counts(outer_indices.size(), 1);
+            counts.insert(std::end(counts), {chunk_count, lat_count, segment.count});
+            variable.getVar(indices, counts, static_cast<void*>(&raw_buffer[0]));  // in the variable's own type
+        }
+        packing.unpack(&raw_buffer[0], &segment_buffer[0], chunk_count * segment_size);
+        for (std::size_t chunk_pos = 0; chunk_pos < chunk_count; ++chunk_pos) {
+            for (std::size_t lat_index = 0; lat_index < lat_count; ++lat_index) {
+                const auto in = std::begin(segment_buffer) + (chunk_pos * lat_count + lat_index) * segment.count;
+                const auto out = std::begin(chunk_buffer)
+                                 + (chunk_pos * lat_count + (lat_reversed ? lat_count - 1 - lat_index : lat_index)) * lon_count + segment.offset;
+                if (lon_reversed) {
+                    std::reverse_copy(in, in + segment.count, out);
+                } else {
+                    std::copy(in, in + segment.count, out);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace impactgen
@@ -0,0 +1,93 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Gathering.h"
+#include <sstream>
+#include <stdexcept>
+
+namespace impactgen {
+
+static bool is_lat_dimension(const std::string& name) { return name == "lat" || name == "latitude" || name == "y"; }
+
+static bool is_lon_dimension(const std::string& name) { return name == "lon" || name == "longitude" || name == "x"; }
+
+bool read_gathering(const netCDF::NcGroup& file,
+                    const netCDF::NcVar& variable,
+                    const GeoGrid<float>& grid,
+                    const std::string& filename,
+                    std::vector<std::size_t>& indices) {
+    const auto& dims = variable.getDims();
+    if (dims.empty()) {
+        return false;
+    }
+    const auto dimension_name = dims.back().getName();
+    const auto index_variable = file.getVar(dimension_name);
+    if (index_variable.isNull() || !check_dimensions(index_variable, {dimension_name})) {
+        return false;
+    }
+    const auto attributes = index_variable.getAtts();  // getAtt throws for missing attributes
+    const auto compress = attributes.find("compress");
+    if (compress == std::end(attributes)) {
+        return false;
+    }
+    std::string compressed_dimensions;
+    compress->second.getValues(compressed_dimensions);
+    std::istringstream ss(compressed_dimensions);
+    std::string first;
+    std::string second;
+    ss >> first >> second;
+    if (!is_lat_dimension(first) || !is_lon_dimension(second)) {
+        throw std::runtime_error(filename + " - " + dimension_name + ": Only gathering of (lat, lon) supported, got '" + compressed_dimensions + "'");
+    }
+    std::vector<long long> values(dims.back().getSize());
+    if (!values.empty()) {
+        index_variable.getVar({0}, {values.size()}, &values[0]);
+    }
+    indices.resize(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (values[i] < 0 || static_cast<std::size_t>(values[i]) >= grid.size()) {
+            throw std::runtime_error(filename + " - " + dimension_name + ": Gathered index out of grid");
+        }
+        indices[i] = values[i];
+    }
+    return true;
+}
+
+GridCells::GridCells(const GeoGrid<float>& grid_p, const std::vector<std::size_t>& gathered_p) : grid(grid_p), gathered(gathered_p) {
+    positions.reserve(gathered.size());
+    for (std::size_t position = 0; position < gathered.size(); ++position) {
+        positions.emplace(gathered[position], position);
+    }
+}
+
+std::size_t GridCells::find(float lat, float lon) const {
+    const auto lat_index = grid.nearest_lat_index(lat);
+    const auto lon_index = grid.nearest_lon_index(lon);
+    if (lat_index < 0 || lon_index < 0 || static_cast<std::size_t>(lat_index) >= grid.lat_count || static_cast<std::size_t>(lon_index) >= grid.lon_count) {
+        return npos;
+    }
+    if (gathered.empty()) {
+        return lat_index * grid.lon_count + lon_index;
+    }
+    const auto it = positions.find(grid.stored_lat_index(lat_index) * grid.lon_count + grid.stored_lon_index(lon_index));
+    return it == std::end(positions) ? npos : it->second;
+}
+
+}  // namespace impactgen
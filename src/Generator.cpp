@@ -0,0 +1,260 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Generator.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace impactgen {
+
+namespace {
+
+enum Stream : std::uint64_t { PROXY = 1, FLOOD_FRACTION, TEMPERATURE, STORM_CENTER_LAT, STORM_CENTER_LON, STORM_RADIUS, STORM_WIND, EVENT_COUNT, LAND };
+
+inline std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+constexpr std::size_t max_write_size = 1 << 22;  // values per write
+constexpr std::size_t max_chunk_size = 1 << 20;  // values per chunk of compressed variables
+constexpr float missing_value = 1e20f;  // as used in ISIMIP data
+
+void add_time_variable(netCDF::NcFile& file, const std::string& units, std::size_t count) {
+    auto time_variable = file.addVar("time", netCDF::NcType::nc_DOUBLE, {file.addDim("time", count)});
+    time_variable.putAtt("units", units);
+    time_variable.putAtt("calendar", "standard");
+    std::vector<double> times(count);
+    for (std::size_t t = 0; t < count; ++t) {
+        times[t] = t;
+    }
+    time_variable.putVar(&times[0]);
+}
+
+}  // namespace
+
+Generator::Generator(const Parameters& parameters_p) : parameters(parameters_p) {
+    const auto& extent = parameters.extent;
+    if (parameters.resolution <= 0 || extent.empty() || parameters.region_count == 0 || parameters.sector_count == 0 || parameters.land_fraction < 0
+        || parameters.land_fraction > 1 || parameters.compression_level < 0 || parameters.compression_level > 9) {
+        throw std::runtime_error("Invalid generator parameters");
+    }
+    grid.lat_abs_stepsize = grid.lat_stepsize = parameters.resolution;
+    grid.lon_abs_stepsize = grid.lon_stepsize = parameters.resolution;
+    grid.lat_count = std::max<std::size_t>(2, std::lround((extent.lat_max - extent.lat_min) / parameters.resolution));
+    grid.lon_count = std::max<std::size_t>(2, std::lround((extent.lon_max - extent.lon_min) / parameters.resolution));
+    grid.lat_min = extent.lat_min + parameters.resolution / 2;
+    grid.lat_max = grid.lat_min + (grid.lat_count - 1) * parameters.resolution;
+    grid.lon_min = extent.lon_min + parameters.resolution / 2;
+    grid.lon_max = grid.lon_min + (grid.lon_count - 1) * parameters.resolution;
+    region_cols = std::min<std::size_t>(grid.lon_count, std::ceil(std::sqrt(parameters.region_count * grid.lon_count / static_cast<double>(grid.lat_count))));
+    region_rows = std::min<std::size_t>(grid.lat_count, (parameters.region_count + region_cols - 1) / region_cols);
+}
+
+double Generator::uniform(std::uint64_t stream, std::uint64_t index) const {
+    return (splitmix64(splitmix64(parameters.seed ^ (stream << 56)) ^ index) >> 11) / 9007199254740992.0;  // 53 random bits
+}
+
+bool Generator::is_land(std::size_t lat_index, std::size_t lon_index) const {
+    if (parameters.land_fraction >= 1) {
+        return true;
+    }
+    const auto block_size = std::max<std::size_t>(1, std::lround(1 / parameters.resolution));
+    const auto block_lon_count = (grid.lon_count + block_size - 1) / block_size;
+    return uniform(LAND, lat_index / block_size * block_lon_count + lon_index / block_size) < parameters.land_fraction;
+}
+
+int Generator::region(std::size_t lat_index, std::size_t lon_index) const {
+    if (!is_land(lat_index, lon_index)) {
+        return -1;
+    }
+    const auto res = lat_index * region_rows / grid.lat_count * region_cols + lon_index * region_cols / grid.lon_count;
+    return static_cast<int>(std::min(res, parameters.region_count - 1));
+}
+
+void Generator::create(netCDF::NcFile& file, const std::string& filename) const {
+    try {
+        file.open(filename, netCDF::NcFile::replace, netCDF::NcFile::nc4);
+    } catch (netCDF::exceptions::NcException& e) {
+        throw std::runtime_error(filename + ": " + e.what());
+    }
+    file.putAtt("created_with", "impactgen");
+    const auto lat_dim = file.addDim("lat", grid.lat_count);
+    const auto lon_dim = file.addDim("lon", grid.lon_count);
+    std::vector<double> lat(grid.lat_count);
+    for (std::size_t i = 0; i < lat.size(); ++i) {
+        lat[i] = grid.lat(i);
+    }
+    std::vector<double> lon(grid.lon_count);
+    for (std::size_t i = 0; i < lon.size(); ++i) {
+        lon[i] = grid.lon(i);
+    }
+    file.addVar("lat", netCDF::NcType::nc_DOUBLE, {lat_dim}).putVar(&lat[0]);
+    file.addVar("lon", netCDF::NcType::nc_DOUBLE, {lon_dim}).putVar(&lon[0]);
+}
+
+netCDF::NcVar Generator::add_variable(netCDF::NcFile& file,
+                                      const std::string& name,
+                                      const netCDF::NcType& type,
+                                      const std::vector<netCDF::NcDim>& dims) const {
+    auto res = file.addVar(name, type, dims);
+    if (parameters.compression_level > 0) {
+        // chunks span whole longitude rows of a single slice, as the readers read slice by slice
+        std::vector<std::size_t> chunk_sizes(dims.size(), 1);
+        chunk_sizes[dims.size() - 1] = grid.lon_count;
+        chunk_sizes[dims.size() - 2] = std::max<std::size_t>(1, std::min(grid.lat_count, max_chunk_size / grid.lon_count));
+        res.setChunking(netCDF::NcVar::nc_CHUNKED, chunk_sizes);
+        res.setCompression(true, true, parameters.compression_level);
+    }
+    return res;
+}
+
+template<typename T, typename Function>
+void Generator::write_slices(const netCDF::NcVar& variable, std::size_t outer_count, Function&& func) const {
+    const auto rows_per_write = std::max<std::size_t>(1, std::min(grid.lat_count, max_write_size / grid.lon_count));
+    const auto outer_dims = static_cast<std::size_t>(variable.getDimCount()) - 2;
+    std::vector<std::size_t> sizes(outer_dims);
+    for (std::size_t d = 0; d < outer_dims; ++d) {
+        sizes[d] = variable.getDim(d).getSize();
+    }
+    std::vector<T> buffer(rows_per_write * grid.lon_count);
+    for (std::size_t outer_index = 0; outer_index < outer_count; ++outer_index) {
+        std::vector<std::size_t> indices(outer_dims + 2, 0);
+        std::vector<std::size_t> counts(outer_dims + 2, 1);
+        for (std::size_t d = outer_dims, rest = outer_index; d > 0; --d) {
+            indices[d - 1] = rest % sizes[d - 1];
+            rest /= sizes[d - 1];
+        }
+        counts[outer_dims + 1] = grid.lon_count;
+        for (std::size_t lat_begin = 0; lat_begin < grid.lat_count; lat_begin += rows_per_write) {
+            const auto rows = std::min(rows_per_write, grid.lat_count - lat_begin);
+#pragma omp parallel for default(shared) schedule(static)
+            for (std::size_t row = 0; row < rows; ++row) {
+                for (std::size_t lon_index = 0; lon_index < grid.lon_count; ++lon_index) {
+                    buffer[row * grid.lon_count + lon_index] = func(outer_index, lat_begin + row, lon_index);
+                }
+            }
+            indices[outer_dims] = lat_begin;
+            counts[outer_dims] = rows;
+            variable.putVar(indices, counts, &buffer[0]);
+        }
+    }
+}
+
+void Generator::write_isoraster(const std::string& filename) const {
+    netCDF::NcFile file;
+    create(file, filename);
+    const auto variable = add_variable(file, "isoraster", netCDF::NcType::nc_INT, {file.getDim("lat"), file.getDim("lon")});
+    variable.putAtt("_FillValue", netCDF::NcType::nc_INT, -1);
+    write_slices<int>(variable, 1, [&](std::size_t, std::size_t lat_index, std::size_t lon_index) { return region(lat_index, lon_index); });
+    const auto write_names = [&](const char* name, std::size_t count, std::string (Generator::*name_of)(std::size_t) const) {
+        std::vector<std::string> names(count);
+        std::vector<const char*> names_chars(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            names[i] = (this->*name_of)(i);
+            names_chars[i] = names[i].c_str();
+        }
+        file.addVar(name, netCDF::NcType::nc_STRING, {file.addDim(name, count)}).putVar(&names_chars[0]);
+    };
+    write_names("index", parameters.region_count, &Generator::region_name);
+    write_names("sector", parameters.sector_count, &Generator::sector_name);
+}
+
+void Generator::write_proxy(const std::string& filename) const {
+    netCDF::NcFile file;
+    create(file, filename);
+    const auto variable = add_variable(file, "proxy", netCDF::NcType::nc_FLOAT, {file.getDim("lat"), file.getDim("lon")});
+    write_slices<float>(variable, 1, [&](std::size_t, std::size_t lat_index, std::size_t lon_index) {
+        if (!is_land(lat_index, lon_index)) {
+            return 0.0f;
+        }
+        return static_cast<float>(1 + 999 * uniform(PROXY, lat_index * grid.lon_count + lon_index));
+    });
+}
+
+void Generator::write_flood_fraction(const std::string& filename) const {
+    netCDF::NcFile file;
+    create(file, filename);
+    add_time_variable(file, time_units(), parameters.timestep_count);
+    const auto variable = add_variable(file, "flood_fraction", netCDF::NcType::nc_FLOAT, {file.getDim("time"), file.getDim("lat"), file.getDim("lon")});
+    variable.putAtt("_FillValue", netCDF::NcType::nc_FLOAT, missing_value);
+    write_slices<float>(variable, parameters.timestep_count, [&](std::size_t t, std::size_t lat_index, std::size_t lon_index) {
+        if (!is_land(lat_index, lon_index)) {
+            return missing_value;
+        }
+        const auto u = uniform(FLOOD_FRACTION, (t * grid.lat_count + lat_index) * grid.lon_count + lon_index);
+        return static_cast<float>(u < 0.9 ? 0 : (u - 0.9) * 10);
+    });
+}
+
+void Generator::write_temperature(const std::string& filename) const {
+    netCDF::NcFile file;
+    create(file, filename);
+    add_time_variable(file, time_units(), parameters.timestep_count);
+    const auto variable = add_variable(file, "temperature", netCDF::NcType::nc_FLOAT, {file.getDim("time"), file.getDim("lat"), file.getDim("lon")});
+    variable.putAtt("_FillValue", netCDF::NcType::nc_FLOAT, missing_value);
+    write_slices<float>(variable, parameters.timestep_count, [&](std::size_t t, std::size_t lat_index, std::size_t lon_index) {
+        if (!is_land(lat_index, lon_index)) {
+            return missing_value;
+        }
+        const auto seasonal = 10 * std::sin(2 * M_PI * t / 365.25);
+        const auto latitudinal = 30 * std::cos(grid.lat(lat_index) * M_PI / 180);
+        return static_cast<float>(seasonal + latitudinal + 10 * uniform(TEMPERATURE, (t * grid.lat_count + lat_index) * grid.lon_count + lon_index));
+    });
+}
+
+void Generator::write_tropical_cyclones(const std::string& filename) const {
+    netCDF::NcFile file;
+    create(file, filename);
+    const auto realization_dim = file.addDim("realization", parameters.realization_count);
+    const auto year_dim = file.addDim("year", parameters.year_count);
+    const auto event_dim = file.addDim("event", parameters.event_count);
+    {
+        std::vector<int> years(parameters.year_count);
+        for (std::size_t y = 0; y < years.size(); ++y) {
+            years[y] = parameters.year_from + static_cast<int>(y);
+        }
+        file.addVar("year", netCDF::NcType::nc_INT, {year_dim}).putVar(&years[0]);
+    }
+    {
+        std::vector<int> event_counts(parameters.realization_count * parameters.year_count);
+        for (std::size_t i = 0; i < event_counts.size(); ++i) {
+            event_counts[i] = 1 + static_cast<int>(uniform(EVENT_COUNT, i) * parameters.event_count);
+        }
+        file.addVar("event_count", netCDF::NcType::nc_INT, {realization_dim, year_dim}).putVar(&event_counts[0]);
+    }
+    const auto variable =
+        add_variable(file, "wind", netCDF::NcType::nc_FLOAT, {realization_dim, year_dim, event_dim, file.getDim("lat"), file.getDim("lon")});
+    const auto extent_lat = grid.lat_max - grid.lat_min;
+    const auto extent_lon = grid.lon_max - grid.lon_min;
+    write_slices<float>(variable, parameters.realization_count * parameters.year_count * parameters.event_count,
+                        [&](std::size_t event, std::size_t lat_index, std::size_t lon_index) {
+                            const auto center_lat = grid.lat_min + uniform(STORM_CENTER_LAT, event) * extent_lat;
+                            const auto center_lon = grid.lon_min + uniform(STORM_CENTER_LON, event) * extent_lon;
+                            const auto radius = 1 + 4 * uniform(STORM_RADIUS, event);  // in degrees
+                            const auto distance = std::hypot(grid.lat(lat_index) - center_lat, grid.lon(lon_index) - center_lon);
+                            return static_cast<float>(distance >= radius ? 0 : (30 + 50 * uniform(STORM_WIND, event)) * (1 - distance / radius));
+                        });
+}
+
+}  // namespace impactgen
@@ -27,7 +27,7 @@
 namespace impactgen {
 
 template<typename T>
-void GeoGrid<T>::read_from_netcdf(const netCDF::NcFile& file, const std::string& filename) {
+void GeoGrid<T>::read_from_netcdf(const netCDF::NcGroup& file, const std::string& filename) {
     {
         auto y_var = file.getVar("y");
         if (y_var.isNull()) {
@@ -85,9 +85,43 @@ void GeoGrid<T>::read_from_netcdf(const netCDF::NcFile& file, const std::string&
         lon_min = std::min(lon_start, lon_stop);
         lon_max = std::max(lon_start, lon_stop);
         lon_abs_stepsize = std::abs(lon_stepsize);
+        lon_rotation = 0;
+        if (lon_max > 180 + lon_abs_stepsize / 2) {  // given in 0..360
+            if (lon_min >= 180 - lon_abs_stepsize / 2) {
+                lon_min -= 360;
+                lon_max -= 360;
+            } else if (std::abs(lon_count * lon_abs_stepsize - 360) < lon_abs_stepsize / 2) {
+                // global grid: canonical first column is the first one (in ascending order) with a center at or beyond 180
+                lon_rotation = static_cast<std::size_t>(std::ceil((180 - lon_min) / lon_abs_stepsize - 1e-3));
+                lon_min += lon_rotation * lon_abs_stepsize - 360;
+                lon_max = lon_min + (lon_count - 1) * lon_abs_stepsize;
+            }  // otherwise, grid spans 180 without being global and is kept in 0..360
+        }
     }
 }
 
+template<typename T>
+GeoGrid<T> GeoGrid<T>::subgrid(const GeoBox<T>& box, std::size_t& lat_begin, std::size_t& lon_begin) const {
+    const auto index_range = [](std::size_t index1, std::size_t index2, std::size_t count, std::size_t& begin) {
+        begin = std::min(index1, index2);
+        begin = begin > 0 ? begin - 1 : 0;
+        return std::min(std::max(index1, index2) + 2, count) - begin;
+    };
+    const auto clamp = [](T v, T min, T max) { return std::min(std::max(v, min), max); };
+    GeoGrid<T> res = *this;
+    res.lat_count = index_range(lat_index(clamp(box.lat_min, lat_min, lat_max)), lat_index(clamp(box.lat_max, lat_min, lat_max)), lat_count, lat_begin);
+    res.lon_count = index_range(lon_index(clamp(box.lon_min, lon_min, lon_max)), lon_index(clamp(box.lon_max, lon_min, lon_max)), lon_count, lon_begin);
+    // values of the part are read in canonical layout
+    res.lat_stepsize = lat_abs_stepsize;
+    res.lon_stepsize = lon_abs_stepsize;
+    res.lon_rotation = 0;
+    res.lat_min = lat(lat_begin);
+    res.lat_max = lat(lat_begin + res.lat_count - 1);
+    res.lon_min = lon(lon_begin);
+    res.lon_max = lon(lon_begin + res.lon_count - 1);
+    return res;
+}
+
 template struct GeoGrid<double>;
 template struct GeoGrid<float>;
 }  // namespace impactgen
@@ -0,0 +1,123 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "GridCache.h"
+#include <sys/stat.h>
+#include <functional>
+#include "InputFile.h"
+
+namespace impactgen {
+
+std::size_t GridCache::KeyHash::operator()(const Key& key) const {
+    return std::hash<std::string>()(key.filename) ^ (std::hash<std::string>()(key.variable) << 1) ^ (std::hash<std::time_t>()(key.mtime) << 2)
+           ^ (key.type.hash_code() << 3);
+}
+
+GridCache& GridCache::instance() {
+    static GridCache cache;
+    static const bool reclaimer_added = [] {
+        MemoryAccounting::instance().add_reclaimer([]() { cache.evict_unused(); });
+        return true;
+    }();
+    (void)reclaimer_added;
+    return cache;
+}
+
+std::time_t GridCache::modification_time(const std::string& filename) {
+    struct stat file_stat = {};
+    if (stat(InputFile::physical_path(filename).c_str(), &file_stat) != 0) {
+        return -1;
+    }
+    return file_stat.st_mtime;
+}
+
+void GridCache::set_memory_limit(std::size_t memory_limit_p) {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    memory_limit = memory_limit_p;
+    shrink(memory_limit);
+}
+
+std::size_t GridCache::get_memory_kept() {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    return memory_kept;
+}
+
+void GridCache::evict_unused() {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    shrink(0);
+}
+
+std::shared_ptr<const void> GridCache::find(const Key& key) {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    auto entry = entries.find(key);
+    if (entry == std::end(entries)) {
+        return nullptr;
+    }
+    auto res = entry->second.value.lock();
+    if (!res) {
+        entries.erase(entry);
+        return nullptr;
+    }
+    if (entry->second.kept) {
+        lru.splice(std::begin(lru), lru, entry->second.lru_position);
+    } else {
+        keep(entry->second, &entry->first);
+    }
+    return res;
+}
+
+void GridCache::insert(const Key& key, std::shared_ptr<const void> value, std::size_t size) {
+    std::lock_guard<std::mutex> guard(mutex_m);
+    auto entry = entries.find(key);
+    if (entry != std::end(entries)) {
+        if (entry->second.kept) {
+            memory_kept -= entry->second.size;
+            lru.erase(entry->second.lru_position);
+        }
+        entries.erase(entry);
+    }
+    entry = entries.emplace(key, Entry{value, nullptr, size, std::end(lru)}).first;
+    keep(entry->second, &entry->first);
+}
+
+void GridCache::keep(Entry& entry, const Key* key) {
+    if (entry.size > memory_limit) {
+        return;  // only available as long as referenced elsewhere
+    }
+    shrink(memory_limit - entry.size);
+    entry.kept = entry.value.lock();
+    entry.lru_position = lru.insert(std::begin(lru), key);
+    memory_kept += entry.size;
+}
+
+void GridCache::shrink(std::size_t limit) {
+    while (memory_kept > limit && !lru.empty()) {
+        const auto key = lru.back();
+        lru.pop_back();
+        auto& entry = entries.at(*key);
+        entry.kept.reset();
+        memory_kept -= entry.size;
+        if (entry.value.expired()) {
+            entries.erase(*key);
+        }
+    }
+}
+
+}  // namespace impactgen
@@ -0,0 +1,115 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "InputFile.h"
+#include <netcdf.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include "Profiling.h"
+#ifdef IMPACTGEN_ZIP_INPUTS
+#include "zip-wrapper.h"
+#endif
+
+namespace impactgen {
+
+#ifdef IMPACTGEN_ZIP_INPUTS
+static std::vector<char> read_archive_member(const std::string& archive_filename, const std::string& member, const std::string& filename) {
+    static std::mutex archives_mutex;
+    static std::unordered_map<std::string, std::unique_ptr<libzip::Archive>> archives;
+    std::lock_guard<std::mutex> guard(archives_mutex);  // libzip handles are not thread-safe
+    auto& archive = archives[archive_filename];
+    try {
+        if (!archive) {
+            archive.reset(new libzip::Archive(archive_filename));
+        }
+        struct zip_stat member_stat;
+        zip_stat_init(&member_stat);
+        if (zip_stat(archive->get_handle(), member.c_str(), 0, &member_stat) != 0 || (member_stat.valid & ZIP_STAT_SIZE) == 0) {
+            throw libzip::exception(zip_strerror(archive->get_handle()));
+        }
+        std::vector<char> res(member_stat.size);
+        if (res.empty()) {
+            return res;
+        }
+        auto in = archive->open(member);
+        if (!in.read(res.data(), res.size())) {
+            throw libzip::exception("could not read from zipped file");
+        }
+        return res;
+    } catch (const libzip::exception& e) {
+        throw std::runtime_error(filename + ": " + e.what());
+    }
+}
+#endif
+
+bool InputFile::split_archive_path(const std::string& filename, std::string& archive, std::string& member) {
+    const auto pos = filename.find(".zip#");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    archive = filename.substr(0, pos + 4);
+    member = filename.substr(pos + 5);
+    return true;
+}
+
+std::string InputFile::physical_path(const std::string& filename) {
+    std::string archive;
+    std::string member;
+    if (split_archive_path(filename, archive, member)) {
+        return archive;
+    }
+    return filename;
+}
+
+InputFile::InputFile(std::string filename_p) : filename(std::move(filename_p)) {
+    IMPACTGEN_PROFILE("netcdf_open");
+    int ncid;
+    int status;
+    std::string archive;
+    std::string member;
+    if (split_archive_path(filename, archive, member)) {
+#ifdef IMPACTGEN_ZIP_INPUTS
+        memory = read_archive_member(archive, member, filename);
+        if (memory.empty()) {
+            throw std::runtime_error(filename + ": Empty file");
+        }
+        status = nc_open_mem(filename.c_str(), NC_NOWRITE, memory.size(), &memory[0], &ncid);
+#else
+        throw std::runtime_error(filename + ": Reading from zip archives not supported (compile with IMPACTGEN_ZIP_INPUTS)");
+#endif
+    } else {
+        status = nc_open(filename.c_str(), NC_NOWRITE, &ncid);
+    }
+    if (status != NC_NOERR) {
+        throw std::runtime_error(filename + ": " + nc_strerror(status));
+    }
+    static_cast<netCDF::NcGroup&>(*this) = netCDF::NcGroup(ncid);
+}
+
+InputFile::~InputFile() {
+    if (!isNull()) {
+        nc_close(getId());
+    }
+}
+
+}  // namespace impactgen
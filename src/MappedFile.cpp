@@ -0,0 +1,121 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace impactgen {
+
+MappedFile::MappedFile(const std::string& filename, Mode mode_p) : mode(mode_p) {
+    if (mode == Mode::SCRATCH) {
+        throw std::runtime_error(filename + ": Scratch mappings are created by MappedFile::scratch");
+    }
+    const int fd = open(filename.c_str(), O_RDONLY);  // NOLINT(hicpp-vararg,cppcoreguidelines-pro-type-vararg)
+    if (fd < 0) {
+        throw std::runtime_error(filename + ": Could not open file");
+    }
+    struct stat file_stat = {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error(filename + ": Could not stat file");
+    }
+    size_m = file_stat.st_size;
+    map(fd, filename);
+}
+
+std::unique_ptr<MappedFile> MappedFile::scratch(const std::string& directory, std::size_t size) {
+    const auto pattern = directory + "/scratch.XXXXXX";
+    std::vector<char> filename(std::begin(pattern), std::end(pattern));
+    filename.push_back('\0');
+    const int fd = mkstemp(&filename[0]);
+    if (fd < 0) {
+        throw std::runtime_error(pattern + ": Could not create scratch file");
+    }
+    unlink(&filename[0]);  // freed as soon as unmapped
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string(&filename[0]) + ": Could not resize scratch file");
+    }
+    std::unique_ptr<MappedFile> res(new MappedFile());
+    res->mode = Mode::SCRATCH;
+    res->size_m = size;
+    res->map(fd, &filename[0]);
+    return res;
+}
+
+void MappedFile::map(int fd, const std::string& filename) {
+    if (size_m > 0) {
+        switch (mode) {
+            case Mode::READ_ONLY:
+                data_m = mmap(nullptr, size_m, PROT_READ, MAP_PRIVATE, fd, 0);
+                break;
+            case Mode::COPY_ON_WRITE:
+                data_m = mmap(nullptr, size_m, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                break;
+            case Mode::SCRATCH:
+                data_m = mmap(nullptr, size_m, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                break;
+        }
+        if (data_m == MAP_FAILED) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+            data_m = nullptr;
+            close(fd);
+            throw std::runtime_error(filename + ": Could not map file");
+        }
+    }
+    close(fd);  // mapping stays valid
+}
+
+void MappedFile::advise(Advice advice, const void* begin, std::size_t length) const {
+    if (!data_m || length == 0) {
+        return;
+    }
+    static const auto page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto aligned_begin = reinterpret_cast<std::uintptr_t>(begin) & ~(page_size - 1);
+    const auto end = reinterpret_cast<std::uintptr_t>(begin) + length;
+    int flag = MADV_NORMAL;
+    switch (advice) {
+        case Advice::NORMAL:
+            flag = MADV_NORMAL;
+            break;
+        case Advice::SEQUENTIAL:
+            flag = MADV_SEQUENTIAL;
+            break;
+        case Advice::RANDOM:
+            flag = MADV_RANDOM;
+            break;
+        case Advice::WILLNEED:
+            flag = MADV_WILLNEED;
+            break;
+    }
+    madvise(reinterpret_cast<void*>(aligned_begin), end - aligned_begin, flag);  // only advice, failure is not an error
+}
+
+MappedFile::~MappedFile() {
+    if (data_m) {
+        munmap(data_m, size_m);
+    }
+}
+
+}  // namespace impactgen
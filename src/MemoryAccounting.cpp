@@ -0,0 +1,134 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "MemoryAccounting.h"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+namespace impactgen {
+
+const char* memory_subsystem_name(MemorySubsystem subsystem) {
+    switch (subsystem) {
+        case MemorySubsystem::CHUNK_BUFFERS:
+            return "chunk_buffers";
+        case MemorySubsystem::GRIDS:
+            return "grids";
+        case MemorySubsystem::FORCING_SERIES:
+            return "forcing_series";
+        case MemorySubsystem::PROXY_CACHE:
+            return "proxy_cache";
+        case MemorySubsystem::OUTPUT:
+            return "output";
+        case MemorySubsystem::ARENA:
+            return "arena";
+    }
+    return "unknown";
+}
+
+static void update_max(std::atomic<std::size_t>& max, std::size_t value) {
+    auto previous = max.load(std::memory_order_relaxed);
+    while (previous < value && !max.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+static std::string mebibytes(std::size_t bytes) { return std::to_string((bytes + (1 << 19)) >> 20) + " MiB"; }
+
+MemoryAccounting& MemoryAccounting::instance() {
+    static MemoryAccounting accounting;
+    return accounting;
+}
+
+void MemoryAccounting::set_limit(std::size_t limit_p) {
+    limit = limit_p;
+    pressure_threshold = limit_p / 10 * 9;
+}
+
+void MemoryAccounting::add_reclaimer(std::function<void()> reclaimer) {
+    std::lock_guard<std::mutex> lock(reclaimers_mutex);
+    reclaimers.emplace_back(std::move(reclaimer));
+}
+
+void MemoryAccounting::reclaim() {
+    if (reclaiming.exchange(true)) {
+        return;  // memory released by reclaimers does not trigger reclaiming again
+    }
+    std::vector<std::function<void()>> to_run;
+    {
+        std::lock_guard<std::mutex> lock(reclaimers_mutex);
+        to_run = reclaimers;
+    }
+    for (const auto& reclaimer : to_run) {
+        reclaimer();
+    }
+    reclaiming = false;
+}
+
+void MemoryAccounting::allocate(MemorySubsystem subsystem, std::size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    const auto index = static_cast<std::size_t>(subsystem);
+    const auto new_total = total.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    const auto new_current = current[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (limit > 0 && new_total > pressure_threshold) {
+        reclaim();
+        if (total > limit) {
+            release(subsystem, bytes);
+            throw std::runtime_error("Memory limit of " + mebibytes(limit) + " exceeded when allocating " + mebibytes(bytes) + " for "
+                                     + memory_subsystem_name(subsystem) + " (" + mebibytes(total) + " in use)");
+        }
+    }
+    update_max(peak[index], new_current);
+    update_max(total_peak, new_total);
+}
+
+void MemoryAccounting::release(MemorySubsystem subsystem, std::size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    current[static_cast<std::size_t>(subsystem)].fetch_sub(bytes, std::memory_order_relaxed);
+    total.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::size_t MemoryAccounting::fitting_count(std::size_t max_count, std::size_t item_size) const {
+    if (limit == 0 || item_size == 0) {
+        return max_count;
+    }
+    const std::size_t used = total;
+    const auto available = used < pressure_threshold ? pressure_threshold - used : 0;
+    return std::max<std::size_t>(1, std::min(max_count, available / item_size));
+}
+
+void MemoryAccounting::write_report(std::ostream& out) const {
+    out << "Memory use (current / peak):\n";
+    for (std::size_t i = 0; i < memory_subsystem_count; ++i) {
+        out << "  " << std::left << std::setw(16) << memory_subsystem_name(static_cast<MemorySubsystem>(i)) << std::right << std::setw(10)
+            << mebibytes(current[i]) << " / " << mebibytes(peak[i]) << '\n';
+    }
+    out << "  " << std::left << std::setw(16) << "total" << std::right << std::setw(10) << mebibytes(total) << " / " << mebibytes(total_peak);
+    if (limit > 0) {
+        out << " (limit " << mebibytes(limit) << ")";
+    }
+    out << '\n';
+}
+
+}  // namespace impactgen
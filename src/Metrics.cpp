@@ -0,0 +1,300 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "MemoryAccounting.h"
+
+namespace impactgen {
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::start(const std::string& socket_path_p, int port) {
+    if (server.joinable()) {
+        throw std::runtime_error("Metrics already started");
+    }
+    // release socket (and socket file, if already bound) before reporting an error, so that start can be retried
+    const auto fail = [this](const std::string& message) {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+        if (!socket_path.empty()) {
+            unlink(socket_path.c_str());
+            socket_path.clear();
+        }
+        throw std::runtime_error(message);
+    };
+    if (!socket_path_p.empty()) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path_p.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error(socket_path_p + ": Socket path too long");
+        }
+        std::strcpy(address.sun_path, socket_path_p.c_str());
+        unlink(socket_path_p.c_str());
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            fail(socket_path_p + ": Could not bind socket: " + std::strerror(errno));
+        }
+        socket_path = socket_path_p;
+    } else {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        const int reuse = 1;
+        if (listen_fd < 0 || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+            || bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            fail("Could not bind metrics port " + std::to_string(port) + ": " + std::strerror(errno));
+        }
+    }
+    if (listen(listen_fd, 8) != 0) {
+        fail(std::string("Could not listen for metrics: ") + std::strerror(errno));
+    }
+    enabled_m = true;
+    stopping = false;
+    server = std::thread([this]() { serve(); });
+}
+
+void Metrics::stop() {
+    if (!server.joinable()) {
+        return;
+    }
+    stopping = true;
+    server.join();
+    close(listen_fd);
+    listen_fd = -1;
+    if (!socket_path.empty()) {
+        unlink(socket_path.c_str());
+        socket_path.clear();
+    }
+    enabled_m = false;
+}
+
+void Metrics::serve() {
+    pollfd listen_poll = {listen_fd, POLLIN, 0};
+    while (!stopping) {
+        if (poll(&listen_poll, 1, 200) <= 0) {
+            continue;
+        }
+        const auto connection = accept(listen_fd, nullptr, nullptr);
+        if (connection < 0) {
+            continue;
+        }
+        // the request itself is not evaluated, every path returns the metrics
+        pollfd request_poll = {connection, POLLIN, 0};
+        char request[1024];
+        if (poll(&request_poll, 1, 1000) > 0) {
+            const auto unused = read(connection, request, sizeof(request));
+            (void)unused;
+        }
+        const auto body = render();
+        const auto response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size())
+                              + "\r\nConnection: close\r\n\r\n" + body;
+        for (std::size_t written = 0; written < response.size();) {
+            const auto res = send(connection, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+            if (res <= 0) {
+                break;
+            }
+            written += res;
+        }
+        close(connection);
+    }
+}
+
+void Metrics::begin_impact(const std::string& name, std::size_t combination_count) {
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    impacts.emplace_back();
+    auto& stats = impacts.back();
+    stats.name = name;
+    stats.begin = std::chrono::steady_clock::now();
+    stats.combination_count = combination_count;
+    current = &stats;
+}
+
+void Metrics::end_combination() {
+    auto* stats = current.load();
+    if (stats) {
+        ++stats->combinations_done;
+        stats->join_step_count = 0;
+        stats->join_steps_done = 0;
+    }
+}
+
+void Metrics::end_impact() {
+    auto* stats = current.exchange(nullptr);
+    if (stats) {
+        stats->elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stats->begin).count();
+    }
+}
+
+void Metrics::begin_join(std::size_t step_count) {
+    auto* stats = current.load();
+    if (stats) {
+        stats->join_steps_done = 0;
+        stats->join_step_count = step_count;
+    }
+}
+
+void Metrics::end_join_step(std::uint64_t timesteps) {
+    auto* stats = current.load(std::memory_order_relaxed);
+    if (stats) {
+        stats->join_steps_done.fetch_add(1, std::memory_order_relaxed);
+        stats->timesteps.fetch_add(timesteps, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::set_queue_depth(const std::string& queue, std::size_t depth) {
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    queue_depths[queue] = depth;
+}
+
+static std::string label_value(const std::string& s) {
+    std::string res;
+    for (const auto c : s) {
+        if (c == '\\' || c == '"') {
+            res += '\\';
+            res += c;
+        } else if (c == '\n') {
+            res += "\\n";
+        } else {
+            res += c;
+        }
+    }
+    return res;
+}
+
+std::string Metrics::render() const {
+    const auto now = std::chrono::steady_clock::now();
+    std::ostringstream out;
+    out << "# HELP impactgen_uptime_seconds Time since start of impactgen\n"
+           "# TYPE impactgen_uptime_seconds gauge\n"
+           "impactgen_uptime_seconds "
+        << std::chrono::duration<double>(now - start_time).count() << '\n';
+    {
+        std::ifstream statm("/proc/self/statm");
+        std::size_t size;
+        std::size_t resident;
+        if (statm >> size >> resident) {
+            out << "# HELP impactgen_resident_memory_bytes Resident set size of the process\n"
+                   "# TYPE impactgen_resident_memory_bytes gauge\n"
+                   "impactgen_resident_memory_bytes "
+                << resident * sysconf(_SC_PAGESIZE) << '\n';
+        }
+    }
+    {
+        const auto& accounting = MemoryAccounting::instance();
+        out << "# HELP impactgen_memory_bytes Memory accounted for by subsystem\n"
+               "# TYPE impactgen_memory_bytes gauge\n";
+        for (std::size_t i = 0; i < memory_subsystem_count; ++i) {
+            const auto subsystem = static_cast<MemorySubsystem>(i);
+            out << "impactgen_memory_bytes{subsystem=\"" << memory_subsystem_name(subsystem) << "\"} " << accounting.get_current(subsystem) << '\n';
+        }
+        out << "# HELP impactgen_memory_peak_bytes Peak memory accounted for by subsystem\n"
+               "# TYPE impactgen_memory_peak_bytes gauge\n";
+        for (std::size_t i = 0; i < memory_subsystem_count; ++i) {
+            const auto subsystem = static_cast<MemorySubsystem>(i);
+            out << "impactgen_memory_peak_bytes{subsystem=\"" << memory_subsystem_name(subsystem) << "\"} " << accounting.get_peak(subsystem) << '\n';
+        }
+        if (accounting.get_limit() > 0) {
+            out << "# HELP impactgen_memory_limit_bytes Memory limit\n"
+                   "# TYPE impactgen_memory_limit_bytes gauge\n"
+                   "impactgen_memory_limit_bytes "
+                << accounting.get_limit() << '\n';
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "# HELP impactgen_queue_depth Number of items waiting in queue\n"
+           "# TYPE impactgen_queue_depth gauge\n";
+    for (const auto& q : queue_depths) {
+        out << "impactgen_queue_depth{queue=\"" << label_value(q.first) << "\"} " << q.second << '\n';
+    }
+    struct Values {
+        std::string impact;
+        double elapsed;
+        std::uint64_t cells;
+        std::uint64_t timesteps;
+        std::uint64_t bytes_read;
+        double progress;
+        bool finished;
+    };
+    std::vector<Values> values;
+    for (const auto& stats : impacts) {
+        Values v;
+        v.impact = label_value(stats.name);
+        const double finished_elapsed = stats.elapsed_seconds;
+        v.finished = finished_elapsed >= 0;
+        v.elapsed = v.finished ? finished_elapsed : std::chrono::duration<double>(now - stats.begin).count();
+        v.cells = stats.cells;
+        v.timesteps = stats.timesteps;
+        v.bytes_read = stats.bytes_read;
+        const std::size_t join_step_count = stats.join_step_count;
+        const double join_progress = join_step_count > 0 ? static_cast<double>(stats.join_steps_done) / join_step_count : 0;
+        v.progress = v.finished ? 1 : (stats.combinations_done + join_progress) / std::max<std::size_t>(stats.combination_count, 1);
+        values.push_back(v);
+    }
+    const auto write_metric = [&](const char* name, const char* type, const char* help, double (*value)(const Values&)) {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            // index distinguishes several impacts of the same type
+            out << name << "{impact=\"" << values[i].impact << "\",index=\"" << i << "\"} " << value(values[i]) << '\n';
+        }
+    };
+    write_metric("impactgen_cells_total", "counter", "Grid cells read", [](const Values& v) { return static_cast<double>(v.cells); });
+    write_metric("impactgen_timesteps_total", "counter", "Time steps processed", [](const Values& v) { return static_cast<double>(v.timesteps); });
+    write_metric("impactgen_bytes_read_total", "counter", "Bytes of forcing data read", [](const Values& v) { return static_cast<double>(v.bytes_read); });
+    write_metric("impactgen_cells_per_second", "gauge", "Grid cells read per second since start of impact",
+                 [](const Values& v) { return v.elapsed > 0 ? v.cells / v.elapsed : 0; });
+    write_metric("impactgen_timesteps_per_second", "gauge", "Time steps processed per second since start of impact",
+                 [](const Values& v) { return v.elapsed > 0 ? v.timesteps / v.elapsed : 0; });
+    write_metric("impactgen_progress_ratio", "gauge", "Estimated share of the impact done", [](const Values& v) { return v.progress; });
+    write_metric("impactgen_eta_seconds", "gauge", "Estimated time remaining for the impact (-1 if unknown)", [](const Values& v) {
+        if (v.finished) {
+            return 0.0;
+        }
+        return v.progress > 0 ? v.elapsed * (1 - v.progress) / v.progress : -1.0;
+    });
+    return out.str();
+}
+
+}  // namespace impactgen
@@ -22,8 +22,13 @@
 #include <algorithm>
 #include <ctime>
 #include <iomanip>
+#include <map>
 #include <sstream>
 #include <stdexcept>
+#include "InputFile.h"
+#include "MemoryAccounting.h"
+#include "Metrics.h"
+#include "Profiling.h"
 #include "TimeVariable.h"
 #include "helpers.h"
 #include "version.h"
@@ -41,7 +46,29 @@ Output::Output(const settings::SettingsNode& settings) {
         }
         throw std::runtime_error("Variable '" + key + "' not found for '" + temp + "'");
     });
-    reference_time = ReferenceTime(settings["reference"].as<std::string>());
+    reference_time = ReferenceTime(settings["reference"].as<std::string>(), calendar::from_name(settings["calendar"].as<std::string>("standard")));
+    if (settings.has("time_range")) {
+        time_range = TimeRange(settings["time_range"]);
+    }
+    if (settings.has("calendar_conversion")) {
+        // for inputs in other calendars than the output: handling of dates not existing in output calendar
+        const auto& conversion = settings["calendar_conversion"].as<settings::hstring>();
+        switch (conversion) {
+            case settings::hstring::hash("previous_day"):
+                missing_dates = calendar::MissingDates::PREVIOUS_DAY;
+                break;
+            case settings::hstring::hash("drop"):
+                missing_dates = calendar::MissingDates::DROP;
+                break;
+            default:
+                throw std::runtime_error("Unknown calendar conversion '" + std::string(conversion) + "'");
+        }
+    }
+    quantize = settings["output"]["quantize"].as<bool>(false);
+    lazy = settings["output"]["lazy"].as<bool>(false);
+    if (settings["output"].has("resample")) {
+        resampling = Resampling(settings["output"]["resample"], reference_time);
+    }
     {
         std::ostringstream ss;
         ss << settings;
@@ -74,12 +101,7 @@ void Output::append_array(const settings::SettingsNode& node, std::vector<std::s
     const auto& type = node["type"].as<std::string>();
     if (type == "netcdf") {
         const auto& filename = node["file"].as<std::string>();
-        netCDF::NcFile infile;
-        try {
-            infile.open(filename, netCDF::NcFile::read);
-        } catch (netCDF::exceptions::NcException& e) {
-            throw std::runtime_error(filename + ": " + e.what());
-        }
+        InputFile infile(filename);
         const auto variable = infile.getVar(node["variable"].as<std::string>());
         const auto count = variable.getDim(0).getSize();
         std::vector<char*> out_(count);
@@ -124,11 +146,31 @@ void Output::open() {
 #endif
     file.putAtt("settings", settings_string);
 
-    agent_forcing = std::make_unique<ForcingSeries<AgentForcing>>(AgentForcing(sectors, regions), reference_time);
+    agent_forcing = std::make_unique<ForcingSeries<AgentForcing>>(AgentForcing(sectors, regions), reference_time, quantize);
+    agent_forcing->set_memory_subsystem(MemorySubsystem::OUTPUT);
 }
 
 void Output::close() {
-    TimeVariable time_variable(agent_forcing->get_sorted_times(), reference_time);
+    IMPACTGEN_PROFILE("output_close");
+    // in lazy mode, operands per output time step, in the order the series have been included
+    std::map<int, std::vector<const AgentForcing*>> lazy_operands;
+    std::vector<std::time_t> times;
+    if (lazy) {
+        // series folded early come first
+        agent_forcing->foreach_forcing(
+            [&](std::time_t time, const AgentForcing& forcing) { lazy_operands[reference_time.reference(time)].push_back(&forcing); });
+        for (const auto& leaf : leaves) {
+            leaf.foreach_forcing(
+                [&](std::time_t time, const AgentForcing& forcing) { lazy_operands[reference_time.reference(time)].push_back(&forcing); });
+        }
+        times.reserve(lazy_operands.size());
+        for (const auto& operands : lazy_operands) {
+            times.push_back(reference_time.unreference(operands.first));
+        }
+    } else {
+        times = agent_forcing->get_sorted_times();
+    }
+    TimeVariable time_variable(std::move(times), reference_time);
     time_variable.write_to_file(file, reference_time);
     const auto dim_time = file.getDim("time");
 
@@ -148,17 +190,89 @@ void Output::close() {
         var_region.putVar(&regions_chars[0]);
     }
 
-    const auto var_agent_forcing = file.addVar("agent_forcing", netCDF::NcType::nc_FLOAT, {dim_time, dim_sector, dim_region});
+    const auto var_agent_forcing =
+        file.addVar("agent_forcing", quantize ? netCDF::NcType::nc_USHORT : netCDF::NcType::nc_FLOAT, {dim_time, dim_sector, dim_region});
+    if (quantize) {
+        var_agent_forcing.putAtt("scale_factor", netCDF::NcType::nc_FLOAT, quantization::scale_factor);
+        var_agent_forcing.putAtt("add_offset", netCDF::NcType::nc_FLOAT, ForcingType(0.0));
+        var_agent_forcing.putAtt("_FillValue", netCDF::NcType::nc_USHORT, quantization::fill_value);
+    }
+    AgentForcing lazy_forcing;
+    auto lazy_operand = std::begin(lazy_operands);
     for (std::size_t t = 0; t < time_variable.times.size(); ++t) {
-        var_agent_forcing.putVar({t, 0, 0}, {1, sectors.size(), regions.size()}, &agent_forcing->get_forcing(time_variable.times[t]).get_data()[0]);
+        AgentForcing* forcing;
+        if (lazy) {
+            // evaluate combination for this time step only, so that the combined series is never stored as a whole
+            auto& operands = lazy_operand->second;
+            lazy_forcing = *operands.front();
+            if (operands.size() > 1) {
+                operands.erase(std::begin(operands));
+                lazy_forcing.include(operands, combination);
+            }
+            forcing = &lazy_forcing;
+            ++lazy_operand;
+        } else {
+            forcing = &agent_forcing->get_forcing(time_variable.times[t]);
+        }
+        if (quantize) {
+            forcing->quantize();
+            var_agent_forcing.putVar({t, 0, 0}, {1, sectors.size(), regions.size()}, &forcing->get_quantized_data()[0]);
+        } else {
+            var_agent_forcing.putVar({t, 0, 0}, {1, sectors.size(), regions.size()}, &forcing->get_data()[0]);
+        }
     }
 }
 
 AgentForcing Output::prepare_forcing() const { return AgentForcing(agent_forcing->base_forcing); }
 
+void Output::include_series(ForcingSeries<AgentForcing>&& forcing) {
+    if (lazy) {
+        if (quantize) {
+            forcing.quantize();
+        }
+        forcing.set_memory_subsystem(MemorySubsystem::OUTPUT);
+        leaves.emplace_back(std::move(forcing));
+        if (MemoryAccounting::instance().under_pressure()) {
+            fold_leaves();
+        }
+    } else {
+        agent_forcing->include(forcing, combination);
+    }
+    update_metrics();
+}
+
+void Output::fold_leaves() {
+    IMPACTGEN_PROFILE("output_fold_leaves");
+    std::vector<const ForcingSeries<AgentForcing>*> operands(leaves.size());
+    std::transform(std::begin(leaves), std::end(leaves), std::begin(operands), [](const ForcingSeries<AgentForcing>& leaf) { return &leaf; });
+    agent_forcing->include(operands, combination);
+    leaves.clear();
+    leaves.shrink_to_fit();
+}
+
+void Output::update_metrics() const {
+    auto& metrics = Metrics::instance();
+    if (!metrics.enabled()) {
+        return;
+    }
+    metrics.set_queue_depth("output_series", leaves.size());
+}
+
+template<>
+void Output::include_forcing<AgentForcing>(ForcingSeries<AgentForcing>&& forcing) {
+    include_series(resampling.enabled() ? resampling.apply(forcing) : std::move(forcing));
+}
+
 template<>
 void Output::include_forcing<AgentForcing>(const ForcingSeries<AgentForcing>& forcing) {
-    agent_forcing->include(forcing, combination);
+    if (resampling.enabled()) {
+        include_series(resampling.apply(forcing));
+    } else if (lazy) {
+        include_series(ForcingSeries<AgentForcing>(forcing));
+    } else {
+        agent_forcing->include(forcing, combination);
+        update_metrics();
+    }
 }
 
 }  // namespace impactgen
@@ -0,0 +1,175 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Packing.h"
+#include <netcdf.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace impactgen {
+
+static double default_fill_value(ClassicNetCDF::Type type) {
+    switch (type) {
+        case ClassicNetCDF::Type::BYTE:
+            return NC_FILL_BYTE;
+        case ClassicNetCDF::Type::SHORT:
+            return NC_FILL_SHORT;
+        case ClassicNetCDF::Type::INT:
+            return NC_FILL_INT;
+        case ClassicNetCDF::Type::FLOAT:
+            return NC_FILL_FLOAT;
+        case ClassicNetCDF::Type::DOUBLE:
+            return NC_FILL_DOUBLE;
+        case ClassicNetCDF::Type::UBYTE:
+            return NC_FILL_UBYTE;
+        case ClassicNetCDF::Type::USHORT:
+            return NC_FILL_USHORT;
+        case ClassicNetCDF::Type::UINT:
+            return NC_FILL_UINT;
+        default:
+            return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+Packing::Packing(const netCDF::NcVar& variable) : type(static_cast<ClassicNetCDF::Type>(variable.getType().getTypeClass())) {
+    switch (type) {
+        case ClassicNetCDF::Type::BYTE:
+        case ClassicNetCDF::Type::SHORT:
+        case ClassicNetCDF::Type::INT:
+        case ClassicNetCDF::Type::FLOAT:
+        case ClassicNetCDF::Type::DOUBLE:
+        case ClassicNetCDF::Type::UBYTE:
+        case ClassicNetCDF::Type::USHORT:
+        case ClassicNetCDF::Type::UINT:
+            break;
+        default:
+            throw std::runtime_error(variable.getName() + ": Unsupported type for forcing values");
+    }
+    const auto attributes = variable.getAtts();  // getAtt throws for missing attributes
+    const auto get_all = [&](const char* name) {
+        std::vector<double> res;
+        const auto attribute = attributes.find(name);
+        if (attribute != std::end(attributes)) {
+            res.resize(attribute->second.getAttLength());  // missing_value may be a vector
+            if (!res.empty()) {
+                attribute->second.getValues(res.data());
+            }
+        }
+        return res;
+    };
+    const auto get = [&](const char* name, double default_value) {
+        const auto values = get_all(name);
+        return values.empty() ? default_value : values.front();
+    };
+    scale_factor = get("scale_factor", 1);
+    add_offset = get("add_offset", 0);
+    missing_values = get_all("missing_value");
+    missing_values.insert(std::begin(missing_values), get("_FillValue", default_fill_value(type)));
+}
+
+bool Packing::is_trivial() const {
+    // negated comparisons so that NaN counts as invalid
+    return type == ClassicNetCDF::Type::FLOAT && scale_factor == 1 && add_offset == 0
+           && std::all_of(std::begin(missing_values), std::end(missing_values), [](double v) { return !(v <= max_valid_forcing); });
+}
+
+// converts value to T if it is exactly representable there; other values (e.g. NaN or out of range) can never match a raw value
+template<typename T>
+static bool to_raw_value(double value, T& res) {
+    if (!(value >= static_cast<double>(std::numeric_limits<T>::lowest()) && value <= static_cast<double>(std::numeric_limits<T>::max()))) {
+        return false;
+    }
+    res = static_cast<T>(value);
+    return std::is_floating_point<T>::value || static_cast<double>(res) == value;
+}
+
+template<typename T>
+void Packing::unpack_typed(const void* in, ForcingType* out, std::size_t size) const {
+    const T* raw = static_cast<const T*>(in);
+    std::vector<T> invalid;
+    invalid.reserve(missing_values.size());
+    for (const auto value : missing_values) {
+        T v;
+        if (to_raw_value(value, v)) {
+            invalid.push_back(v);
+        }
+    }
+    const auto scale = scale_factor;
+    const auto offset = add_offset;
+    const auto nan = std::numeric_limits<ForcingType>::quiet_NaN();
+    if (invalid.empty()) {
+        for (std::size_t i = 0; i < size; ++i) {
+            out[i] = static_cast<ForcingType>(raw[i]) * scale + offset;
+        }
+        return;
+    }
+    // the validity mask only selects between constants (added to the unpacked value), so the loop is if-converted and vectorized
+    // without needing -fno-trapping-math; the first two invalid values (usually _FillValue and missing_value) are checked while
+    // unpacking, any further ones in additional passes
+    const T first = invalid[0];
+    const T second = invalid.size() > 1 ? invalid[1] : first;
+    for (std::size_t i = 0; i < size; ++i) {
+        const T v = raw[i];
+        const bool valid = (v != first) & (v != second);
+        out[i] = (static_cast<ForcingType>(v) * scale + offset) + (valid ? ForcingType(0) : nan);
+    }
+    for (std::size_t k = 2; k < invalid.size(); ++k) {
+        const T m = invalid[k];
+        for (std::size_t i = 0; i < size; ++i) {
+            out[i] += raw[i] != m ? ForcingType(0) : nan;
+        }
+    }
+}
+
+void Packing::unpack(const void* in, ForcingType* out, std::size_t size) const {
+    switch (type) {
+        case ClassicNetCDF::Type::BYTE:
+            unpack_typed<std::int8_t>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::SHORT:
+            unpack_typed<std::int16_t>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::INT:
+            unpack_typed<std::int32_t>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::FLOAT:
+            unpack_typed<float>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::DOUBLE:
+            unpack_typed<double>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::UBYTE:
+            unpack_typed<std::uint8_t>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::USHORT:
+            unpack_typed<std::uint16_t>(in, out, size);
+            break;
+        case ClassicNetCDF::Type::UINT:
+            unpack_typed<std::uint32_t>(in, out, size);
+            break;
+        default:
+            throw std::runtime_error("Unsupported type for forcing values");
+    }
+}
+
+}  // namespace impactgen
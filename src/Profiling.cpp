@@ -0,0 +1,188 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Profiling.h"
+
+#ifdef IMPACTGEN_PROFILING
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace impactgen {
+namespace profiling {
+
+namespace {
+
+std::string json_string(const std::string& s) {
+    std::string res = "\"";
+    for (const auto c : s) {
+        switch (c) {
+            case '"':
+                res += "\\\"";
+                break;
+            case '\\':
+                res += "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    res += buf;
+                } else {
+                    res += c;
+                }
+        }
+    }
+    return res + "\"";
+}
+
+struct PhaseTotal {
+    std::size_t count = 0;
+    std::int64_t duration = 0;
+};
+
+using PhaseTotals = std::map<std::string, PhaseTotal>;
+
+void write_phase_totals(std::ostream& out, const PhaseTotals& totals) {
+    out << '{';
+    bool first = true;
+    for (const auto& total : totals) {
+        out << (first ? "" : ",") << json_string(total.first) << ":{\"count\":" << total.second.count
+            << ",\"seconds\":" << total.second.duration / 1e6 << '}';
+        first = false;
+    }
+    out << '}';
+}
+
+std::ofstream open_output(const std::string& filename) {
+    std::ofstream res(filename);
+    if (!res) {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    return res;
+}
+
+}  // namespace
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+std::vector<Profiler::Event>& Profiler::events_of_this_thread() {
+    thread_local std::vector<Event>* events = nullptr;
+    if (!events) {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_events.emplace_back(new std::vector<Event>());
+        events = thread_events.back().get();
+    }
+    return *events;
+}
+
+void Profiler::set_context(std::string impact, std::string combination) {
+    std::lock_guard<std::mutex> lock(mutex);
+    contexts.push_back(Context{std::move(impact), std::move(combination)});
+    current_context = contexts.size() - 1;
+}
+
+void Profiler::record(const char* phase, std::int64_t begin, std::int64_t end) {
+    events_of_this_thread().push_back(Event{phase, current_context, begin, end - begin});
+}
+
+void Profiler::add_bytes_read(const std::string& filename, std::uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes_read[filename] += bytes;
+}
+
+void Profiler::write_summary(const std::string& filename) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    PhaseTotals all;
+    std::map<std::string, PhaseTotals> per_impact;
+    std::vector<PhaseTotals> per_context(contexts.size());
+    std::vector<PhaseTotals> per_thread(thread_events.size());
+    for (std::size_t thread = 0; thread < thread_events.size(); ++thread) {
+        for (const auto& event : *thread_events[thread]) {
+            for (auto* totals : {&all, &per_impact[contexts[event.context].impact], &per_context[event.context], &per_thread[thread]}) {
+                auto& total = (*totals)[event.phase];
+                ++total.count;
+                total.duration += event.duration;
+            }
+        }
+    }
+    auto out = open_output(filename);
+    out << "{\"seconds\":" << now() / 1e6 << ",\"phases\":";
+    write_phase_totals(out, all);
+    out << ",\"impacts\":{";
+    bool first = true;
+    for (const auto& impact : per_impact) {
+        out << (first ? "" : ",") << json_string(impact.first) << ':';
+        write_phase_totals(out, impact.second);
+        first = false;
+    }
+    out << "},\"combinations\":[";
+    first = true;
+    for (std::size_t context = 0; context < contexts.size(); ++context) {
+        if (per_context[context].empty()) {
+            continue;
+        }
+        out << (first ? "" : ",") << "{\"impact\":" << json_string(contexts[context].impact)
+            << ",\"combination\":" << json_string(contexts[context].combination) << ",\"phases\":";
+        write_phase_totals(out, per_context[context]);
+        out << '}';
+        first = false;
+    }
+    out << "],\"threads\":[";
+    for (std::size_t thread = 0; thread < per_thread.size(); ++thread) {
+        out << (thread == 0 ? "" : ",");
+        write_phase_totals(out, per_thread[thread]);
+    }
+    out << "],\"files\":{";
+    first = true;
+    for (const auto& file : std::map<std::string, std::uint64_t>(std::begin(bytes_read), std::end(bytes_read))) {
+        out << (first ? "" : ",") << json_string(file.first) << ":{\"bytes_read\":" << file.second << '}';
+        first = false;
+    }
+    out << "}}\n";
+}
+
+void Profiler::write_trace(const std::string& filename) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto out = open_output(filename);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (std::size_t thread = 0; thread < thread_events.size(); ++thread) {
+        for (const auto& event : *thread_events[thread]) {
+            const auto& context = contexts[event.context];
+            out << (first ? "" : ",") << "\n{\"name\":" << json_string(event.phase) << ",\"cat\":" << json_string(context.impact)
+                << ",\"ph\":\"X\",\"ts\":" << event.begin << ",\"dur\":" << event.duration << ",\"pid\":0,\"tid\":" << thread
+                << ",\"args\":{\"combination\":" << json_string(context.combination) << "}}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+}  // namespace profiling
+}  // namespace impactgen
+
+#endif
@@ -19,79 +19,79 @@
 */
 
 #include "ReferenceTime.h"
-#include <iomanip>
+#include <cstdio>
 #include <sstream>
 #include <stdexcept>
-#include "helpers.h"
 
 namespace impactgen {
 
-static std::pair<std::time_t, int> parse_netcdf_format(const std::string& netcdf_format) {
-    std::tm res = {};
-    std::istringstream ss(netcdf_format);
-    ss >> std::get_time(&res, "days since %Y-%m-%d");
-    if (!ss.fail()) {
-        return std::make_pair(std::mktime(&res), 24 * 60 * 60);
-    }
-    ss.clear();
-    ss >> std::get_time(&res, "hours since %Y-%m-%d %H:00");
-    if (!ss.fail()) {
-        return std::make_pair(std::mktime(&res), 60 * 60);
+static int parse_unit(const std::string& unit) {
+    if (unit == "days" || unit == "day" || unit == "d") {
+        return 24 * 60 * 60;
     }
-    ss.clear();
-    ss >> std::get_time(&res, "minutes since %Y-%m-%d %H:%M");
-    if (!ss.fail()) {
-        return std::make_pair(std::mktime(&res), 60);
+    if (unit == "hours" || unit == "hour" || unit == "h") {
+        return 60 * 60;
     }
-    ss.clear();
-    ss >> std::get_time(&res, "minutes since %Y-%m-%d %H:%M:00");
-    if (!ss.fail()) {
-        return std::make_pair(std::mktime(&res), 60);
+    if (unit == "minutes" || unit == "minute" || unit == "min") {
+        return 60;
     }
-    ss.clear();
-    ss >> std::get_time(&res, "seconds since %Y-%m-%d %H:%M:%S");
-    if (!ss.fail()) {
-        return std::make_pair(std::mktime(&res), 1);
+    if (unit == "seconds" || unit == "second" || unit == "s") {
+        return 1;
     }
-    return std::make_pair(-1, 0);
+    return 0;
 }
 
-std::time_t ReferenceTime::year(int year_p) {
-    std::tm t = {};
-    t.tm_year = year_p - 1900;
-    return std::mktime(&t);
-}
-
-ReferenceTime::ReferenceTime(const std::string& netcdf_format) {
-    auto p = parse_netcdf_format(netcdf_format);
-    if (p.second == 0) {
-        p = parse_netcdf_format(replace_all(netcdf_format, "-", "-0"));
+// parses "<unit> since YYYY-M-D[( |T)h[:m[:s]]]" (as used in netCDF units attributes)
+ReferenceTime::ReferenceTime(const std::string& netcdf_format, Calendar calendar_p) : calendar(calendar_p) {
+    std::istringstream ss(netcdf_format);
+    std::string unit;
+    std::string since;
+    std::string date;
+    std::string clock;
+    ss >> unit >> since >> date >> clock;
+    accuracy = parse_unit(unit);
+    calendar::Date d{0, 0, 0};
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    char rest;
+    const auto t_pos = date.find('T');
+    if (t_pos != std::string::npos) {
+        clock = date.substr(t_pos + 1);
+        date.resize(t_pos);
     }
-    if (p.second == 0) {
+    if (accuracy == 0 || since != "since" || std::sscanf(date.c_str(), "%d-%u-%u%c", &d.year, &d.month, &d.day, &rest) != 3 || d.month < 1 || d.month > 12
+        || d.day < 1 || d.day > 31
+        || (!clock.empty() && clock != "Z" && std::sscanf(clock.c_str(), "%d:%d:%d", &hour, &minute, &second) < 1)) {
         throw std::runtime_error("Unknown time reference '" + netcdf_format + "'");
     }
-    std::tie(time, accuracy) = p;
+    time = calendar::to_time(calendar, d, hour, minute, second);
 }
 
 std::string ReferenceTime::to_netcdf_format() const {
-    std::ostringstream res;
+    const auto date = calendar::to_date(calendar, time);
+    const auto seconds_of_day = time - calendar::days_from_date(calendar, date.year, date.month, date.day) * calendar::seconds_per_day;
+    const int hour = seconds_of_day / (60 * 60);
+    const int minute = (seconds_of_day / 60) % 60;
+    const int second = seconds_of_day % 60;
+    char buf[64];
     switch (accuracy) {
         case 1:
-            res << "seconds since " << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
+            std::snprintf(buf, sizeof(buf), "seconds since %04d-%02u-%02u %02d:%02d:%02d", date.year, date.month, date.day, hour, minute, second);
             break;
         case 60:
-            res << "minutes since " << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M");
+            std::snprintf(buf, sizeof(buf), "minutes since %04d-%02u-%02u %02d:%02d", date.year, date.month, date.day, hour, minute);
             break;
         case 60 * 60:
-            res << "hours since " << std::put_time(std::localtime(&time), "%Y-%m-%d %H:00");
+            std::snprintf(buf, sizeof(buf), "hours since %04d-%02u-%02u %02d:00", date.year, date.month, date.day, hour);
             break;
         case 24 * 60 * 60:
-            res << "days since " << std::put_time(std::localtime(&time), "%Y-%m-%d");
+            std::snprintf(buf, sizeof(buf), "days since %04d-%02u-%02u", date.year, date.month, date.day);
             break;
         default:
             throw std::runtime_error("Invalid accuracy of " + std::to_string(accuracy));
     }
-    return res.str();
+    return buf;
 }
 
 }  // namespace impactgen
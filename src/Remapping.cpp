@@ -0,0 +1,118 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Remapping.h"
+#include <algorithm>
+#include <cmath>
+
+namespace impactgen {
+
+namespace {
+
+struct Axis {
+    double first_edge;
+    double stepsize;
+    std::size_t count;
+};
+
+inline Axis lat_axis(const GeoGrid<float>& grid) { return {grid.lat_min - grid.lat_abs_stepsize / 2.0, grid.lat_abs_stepsize, grid.lat_count}; }
+
+inline Axis lon_axis(const GeoGrid<float>& grid) { return {grid.lon_min - grid.lon_abs_stepsize / 2.0, grid.lon_abs_stepsize, grid.lon_count}; }
+
+inline bool is_integer(double v) { return std::abs(v - std::round(v)) < 1e-3; }
+
+// true if each cell of coarse is a union of whole cells of fine
+inline bool is_refinement(const Axis& fine, const Axis& coarse) {
+    const auto ratio = coarse.stepsize / fine.stepsize;
+    return ratio > 0.5 && is_integer(ratio) && is_integer((fine.first_edge - coarse.first_edge) / fine.stepsize);
+}
+
+// appends the edges of axis strictly inside (begin, end)
+inline void add_edges(const Axis& axis, double begin, double end, std::vector<double>& edges) {
+    const auto first = std::max(0.0, std::floor((begin - axis.first_edge) / axis.stepsize) + 1);
+    const auto last = std::min(static_cast<double>(axis.count), std::ceil((end - axis.first_edge) / axis.stepsize) - 1);
+    for (auto k = first; k <= last; ++k) {
+        edges.push_back(axis.first_edge + k * axis.stepsize);
+    }
+}
+
+// splits [begin, end] along the edges of the given axes into segments (given by their boundaries)
+inline void split(double begin, double end, const Axis& axis1, const Axis* axis2, std::vector<double>& boundaries) {
+    boundaries.clear();
+    boundaries.push_back(begin);
+    add_edges(axis1, begin, end, boundaries);
+    if (axis2) {
+        add_edges(*axis2, begin, end, boundaries);
+    }
+    boundaries.push_back(end);
+    std::sort(std::begin(boundaries), std::end(boundaries));
+    // drop (almost) empty segments from coinciding edges
+    const auto tolerance = (end - begin) * 1e-6;
+    boundaries.erase(std::unique(std::begin(boundaries), std::end(boundaries), [&](double a, double b) { return b - a < tolerance; }), std::end(boundaries));
+    boundaries.back() = end;
+}
+
+constexpr double deg_to_rad = 3.14159265358979323846 / 180;
+
+}  // namespace
+
+ConservativeRemapping::ConservativeRemapping(const GridCells& source_p, const GridCells& target1_p, const GridCells* target2_p)
+    : source(source_p), target1(target1_p), target2(target2_p) {
+    const auto& source_grid = source.get_grid();
+    block_sum = is_refinement(lat_axis(source_grid), lat_axis(target1.get_grid())) && is_refinement(lon_axis(source_grid), lon_axis(target1.get_grid()))
+                && (!target2
+                    || (is_refinement(lat_axis(source_grid), lat_axis(target2->get_grid()))
+                        && is_refinement(lon_axis(source_grid), lon_axis(target2->get_grid()))));
+}
+
+void ConservativeRemapping::pieces(std::size_t position, std::vector<Piece>& res) const {
+    res.clear();
+    const auto lat = source.lat(position);
+    const auto lon = source.lon(position);
+    if (block_sum) {
+        res.push_back(Piece{target1.find(lat, lon), target2 ? target2->find(lat, lon) : GridCells::npos, 1, lat, lon});
+        return;
+    }
+    const auto& source_grid = source.get_grid();
+    const double lat_begin = lat - source_grid.lat_abs_stepsize / 2.0;
+    const double lat_end = lat + source_grid.lat_abs_stepsize / 2.0;
+    const double lon_begin = lon - source_grid.lon_abs_stepsize / 2.0;
+    const double lon_end = lon + source_grid.lon_abs_stepsize / 2.0;
+    const auto lat_axis2 = target2 ? lat_axis(target2->get_grid()) : Axis();
+    const auto lon_axis2 = target2 ? lon_axis(target2->get_grid()) : Axis();
+    std::vector<double> lat_boundaries;
+    std::vector<double> lon_boundaries;
+    split(lat_begin, lat_end, lat_axis(target1.get_grid()), target2 ? &lat_axis2 : nullptr, lat_boundaries);
+    split(lon_begin, lon_end, lon_axis(target1.get_grid()), target2 ? &lon_axis2 : nullptr, lon_boundaries);
+    // area of a cell on the sphere is proportional to its longitude extent times the difference of the sines of its latitude bounds
+    const auto lat_area = std::sin(lat_end * deg_to_rad) - std::sin(lat_begin * deg_to_rad);
+    const auto lon_extent = lon_end - lon_begin;
+    for (std::size_t i = 0; i + 1 < lat_boundaries.size(); ++i) {
+        const auto lat_fraction = (std::sin(lat_boundaries[i + 1] * deg_to_rad) - std::sin(lat_boundaries[i] * deg_to_rad)) / lat_area;
+        const auto piece_lat = static_cast<float>((lat_boundaries[i] + lat_boundaries[i + 1]) / 2);
+        for (std::size_t j = 0; j + 1 < lon_boundaries.size(); ++j) {
+            const auto piece_lon = static_cast<float>((lon_boundaries[j] + lon_boundaries[j + 1]) / 2);
+            res.push_back(Piece{target1.find(piece_lat, piece_lon), target2 ? target2->find(piece_lat, piece_lon) : GridCells::npos,
+                                lat_fraction * (lon_boundaries[j + 1] - lon_boundaries[j]) / lon_extent, piece_lat, piece_lon});
+        }
+    }
+}
+
+}  // namespace impactgen
@@ -0,0 +1,94 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include "Resampling.h"
+#include <stdexcept>
+#include <string>
+
+namespace impactgen {
+
+static constexpr std::time_t week = 7 * 24 * 60 * 60;
+
+Resampling::Resampling(const settings::SettingsNode& node, ReferenceTime reference_time_p) : reference_time(reference_time_p) {
+    const auto& period_name = node["period"].as<settings::hstring>();
+    switch (period_name) {
+        case settings::hstring::hash("week"):
+        case settings::hstring::hash("weekly"):
+            period = Period::WEEK;
+            break;
+        case settings::hstring::hash("month"):
+        case settings::hstring::hash("monthly"):
+            period = Period::MONTH;
+            break;
+        default:
+            throw std::runtime_error("Unknown resampling period '" + std::string(period_name) + "'");
+    }
+    const auto& aggregation_name = node["aggregation"].as<settings::hstring>("mean");
+    switch (aggregation_name) {
+        case settings::hstring::hash("mean"):
+            aggregation = ForcingAggregation::MEAN;
+            break;
+        case settings::hstring::hash("min"):
+        case settings::hstring::hash("minimum"):
+            aggregation = ForcingAggregation::MIN;
+            break;
+        case settings::hstring::hash("max"):
+        case settings::hstring::hash("maximum"):
+            aggregation = ForcingAggregation::MAX;
+            break;
+        case settings::hstring::hash("product"):
+            aggregation = ForcingAggregation::PRODUCT;
+            break;
+        default:
+            throw std::runtime_error("Unknown resampling aggregation '" + std::string(aggregation_name) + "'");
+    }
+}
+
+std::time_t Resampling::period_begin(std::time_t time) const {
+    switch (period) {
+        case Period::WEEK: {
+            const auto origin = reference_time.unreference(0);
+            auto offset = (time - origin) % week;
+            if (offset < 0) {
+                offset += week;
+            }
+            return time - offset;
+        }
+        case Period::MONTH: {
+            const auto date = calendar::to_date(reference_time.get_calendar(), time);
+            return calendar::to_time(reference_time.get_calendar(), {date.year, date.month, 1});
+        }
+        default:
+            return time;
+    }
+}
+
+std::time_t Resampling::period_end(std::time_t begin) const {
+    switch (period) {
+        case Period::WEEK:
+            return begin + week;
+        case Period::MONTH:
+            return calendar::to_time(reference_time.get_calendar(), calendar::next_month(calendar::to_date(reference_time.get_calendar(), begin)));
+        default:
+            return begin;
+    }
+}
+
+}  // namespace impactgen
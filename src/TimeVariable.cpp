@@ -20,13 +20,66 @@
 
 #include "TimeVariable.h"
 #include <algorithm>
-#include <iomanip>
-#include <sstream>
+#include <cstdio>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace impactgen {
 
-TimeVariable::TimeVariable(const netCDF::NcFile& file, const std::string& filename, int time_shift) {
+static calendar::Date parse_time_bound(const settings::SettingsNode& node, bool is_end) {
+    const auto& value = node.as<std::string>();
+    calendar::Date res{0, 1, 1};
+    if (value.find_first_not_of("0123456789") == std::string::npos) {
+        res.year = std::stoi(value) + (is_end ? 1 : 0);
+        return res;
+    }
+    char rest;
+    if (std::sscanf(value.c_str(), "%d-%u-%u%c", &res.year, &res.month, &res.day, &rest) != 3 || res.month < 1 || res.month > 12 || res.day < 1
+        || res.day > 31) {
+        throw std::runtime_error("Invalid time '" + value + "' (expected year or YYYY-MM-DD)");
+    }
+    if (is_end) {
+        ++res.day;  // may exceed the month, which is fine as dates are only converted to day counts
+    }
+    return res;
+}
+
+TimeRange::TimeRange(const settings::SettingsNode& node) {
+    if (node.has("from")) {
+        from = parse_time_bound(node["from"], false);
+    }
+    if (node.has("to")) {
+        to = parse_time_bound(node["to"], true);
+    }
+    if (!(from < to)) {
+        throw std::runtime_error("time_range: 'from' value should be less than 'to' value");
+    }
+}
+
+bool TimeRange::unbounded() const { return from.year == TimeRange().from.year && to.year == TimeRange().to.year; }
+
+std::time_t TimeRange::begin(Calendar calendar) const {
+    if (from.year == TimeRange().from.year) {
+        return std::numeric_limits<std::time_t>::lowest();
+    }
+    return calendar::to_time(calendar, from);
+}
+
+std::time_t TimeRange::end(Calendar calendar) const {
+    if (to.year == TimeRange().to.year) {
+        return std::numeric_limits<std::time_t>::max();
+    }
+    return calendar::to_time(calendar, to);
+}
+
+TimeRange TimeRange::intersect(const TimeRange& other) const {
+    TimeRange res;
+    res.from = from < other.from ? other.from : from;
+    res.to = to < other.to ? to : other.to;
+    return res;
+}
+
+TimeVariable::TimeVariable(const netCDF::NcGroup& file, const std::string& filename, int time_shift, const TimeRange& range) {
     const auto time_variable = file.getVar("time");
     const auto time_dimension = file.getDim("time");
     if (time_variable.isNull() || time_dimension.isNull()) {
@@ -37,19 +90,72 @@ TimeVariable::TimeVariable(const netCDF::NcFile& file, const std::string& filena
     }
     std::string time_units;
     time_variable.getAtt("units").getValues(time_units);
-    reference_time = ReferenceTime(time_units);
+    Calendar calendar = Calendar::STANDARD;
+    const auto attributes = time_variable.getAtts();  // getAtt throws for missing attributes
+    const auto calendar_attribute = attributes.find("calendar");
+    if (calendar_attribute != std::end(attributes)) {
+        std::string calendar_name;
+        calendar_attribute->second.getValues(calendar_name);
+        calendar = calendar::from_name(calendar_name);
+    }
+    reference_time = ReferenceTime(time_units, calendar);
     times.resize(time_dimension.getSize());
     std::vector<int> tmp(times.size());
     time_variable.getVar({0}, {time_dimension.getSize()}, &tmp[0]);
-    std::transform(std::begin(tmp), std::end(tmp), std::begin(times), [&](int t) -> std::time_t { return reference_time.unreference(t + time_shift); });
+    // plain linear conversion (no per-element calendar calls) so that it vectorizes
+    const std::time_t origin = reference_time.unreference(time_shift);
+    const std::time_t accuracy = reference_time.get_accuracy();
+    const auto* in = tmp.data();
+    auto* out = times.data();
+    const auto count = times.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = in[i] * accuracy + origin;
+    }
+    if (!range.unbounded()) {
+        if (!std::is_sorted(std::begin(times), std::end(times))) {
+            throw std::runtime_error(filename + ": Time axis not sorted, cannot select time range");
+        }
+        const auto first = std::lower_bound(std::begin(times), std::end(times), range.begin(calendar));
+        const auto last = std::lower_bound(first, std::end(times), range.end(calendar));
+        offset = first - std::begin(times);
+        times = std::vector<std::time_t>(first, last);
+    }
 }
 
 TimeVariable::TimeVariable(std::vector<std::time_t> times_p, ReferenceTime reference_time_p) : reference_time(reference_time_p), times(std::move(times_p)) {}
 
+std::size_t TimeVariable::convert_to(Calendar calendar_p, calendar::MissingDates missing_dates) {
+    const auto calendar = reference_time.get_calendar();
+    if (calendar == calendar_p) {
+        return 0;
+    }
+    dropped.assign(times.size(), false);
+    std::vector<std::size_t> missing;  // indices of time steps with dates not existing in calendar_p
+    std::unordered_set<std::time_t> taken;
+    for (std::size_t t = 0; t < times.size(); ++t) {
+        if (calendar::exists(calendar_p, calendar::to_date(calendar, times[t]))) {
+            times[t] = calendar::convert(calendar, calendar_p, times[t]);
+            taken.insert(times[t]);
+        } else {
+            missing.push_back(t);
+        }
+    }
+    std::size_t res = 0;
+    for (const auto t : missing) {
+        times[t] = calendar::convert(calendar, calendar_p, times[t]);
+        if (missing_dates == calendar::MissingDates::DROP || !taken.insert(times[t]).second) {
+            dropped[t] = true;
+            ++res;
+        }
+    }
+    reference_time = ReferenceTime(calendar::convert(calendar, calendar_p, reference_time.unreference(0)), reference_time.get_accuracy(), calendar_p);
+    return res;
+}
+
 void TimeVariable::write_to_file(const netCDF::NcFile& file, const ReferenceTime& reference_time) {
     const auto time_dimension = file.addDim("time", times.size());
     const auto time_variable = file.addVar("time", netCDF::NcType::nc_INT, time_dimension);
-    time_variable.putAtt("calendar", "standard");  // TODO calendar
+    time_variable.putAtt("calendar", calendar::name(reference_time.get_calendar()));
     time_variable.putAtt("units", reference_time.to_netcdf_format());
     std::vector<int> res(times.size());
     std::transform(std::begin(times), std::end(times), std::begin(res), [&](std::time_t t) -> int { return reference_time.reference(t); });
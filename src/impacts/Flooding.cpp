@@ -24,7 +24,13 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include "DiskCache.h"
+#include "ForcingReader.h"
+#include "Gathering.h"
 #include "GeoGrid.h"
+#include "InputFile.h"
+#include "Metrics.h"
 #include "Output.h"
 #include "TimeVariable.h"
 #include "helpers.h"
@@ -52,69 +58,99 @@ Flooding::Flooding(const settings::SettingsNode& impact_node, AgentForcing base_
 
 void Flooding::join(Output& output, const TemplateFunction& template_func) {
     auto filename = fill_template(forcing_filename, template_func);
-    netCDF::NcFile forcing_file;
-    try {
-        forcing_file.open(filename, netCDF::NcFile::read);
-    } catch (netCDF::exceptions::NcException& e) {
-        throw std::runtime_error(filename + ": " + e.what());
-    }
+    InputFile forcing_file(filename);
     const auto forcing_variable = forcing_file.getVar(forcing_varname);
     if (forcing_variable.isNull()) {
         throw std::runtime_error(filename + ": Variable '" + forcing_varname + "' not found");
     }
-    if (!check_dimensions(forcing_variable, {"time", "lat", "lon"}) && !check_dimensions(forcing_variable, {"time", "latitude", "longitude"})) {
-        throw std::runtime_error(filename + " - " + forcing_varname + ": Unexpected dimensions");
+    TimeVariable time_variable(forcing_file, filename, time_shift, time_range.intersect(output.get_time_range()));
+    // forcings are inserted at times in the calendar of the output
+    const auto dropped = time_variable.convert_to(output.ref().get_calendar(), output.get_missing_dates());
+    if (dropped > 0) {
+        std::cerr << "Warning: " << filename << ": " << dropped << " time steps dropped (dates not existing in output calendar)" << std::endl;
     }
-    TimeVariable time_variable(forcing_file, filename, time_shift);
     GeoGrid<float> forcing_grid;
     forcing_grid.read_from_netcdf(forcing_file, filename);
-    if (!isoraster_grid.is_compatible(forcing_grid)) {
-        throw std::runtime_error(filename + ": Forcing and ISO raster not compatible in raster resolution");
+    std::vector<std::size_t> forcing_gathering;
+    if (read_gathering(forcing_file, forcing_variable, forcing_grid, filename, forcing_gathering)) {
+        if (!check_dimensions(forcing_variable, {"time", ""})) {
+            throw std::runtime_error(filename + " - " + forcing_varname + ": Unexpected dimensions");
+        }
+    } else if (!check_dimensions(forcing_variable, {"time", "lat", "lon"}) && !check_dimensions(forcing_variable, {"time", "latitude", "longitude"})) {
+        throw std::runtime_error(filename + " - " + forcing_varname + ": Unexpected dimensions");
     }
 
     read_proxy(fill_template(proxy_filename, template_func), output.get_regions());
 
     auto forcing_series = ForcingSeries<AgentForcing>(base_forcing, output.ref());
-    if (last.data().empty()) {
-        last.resize(0, forcing_grid.lat_count, forcing_grid.lon_count);
-    } else if (!forcing_grid.is_compatible(last_grid) || forcing_grid.lat_count != last_grid.lat_count || forcing_grid.lon_count != last_grid.lon_count) {
-        throw std::runtime_error(filename + ": Incompatible grids");
+    forcing_series.set_pool(forcing_pool);
+    const bool use_points = use_region_points(forcing_grid, forcing_gathering);
+    if (!use_points) {
+        if (last.data().empty()) {
+            const auto& disk_cache = DiskCache::instance();
+            if (disk_cache.enabled() && forcing_grid.size() * sizeof(ForcingType) >= scratch_min_size) {
+                last.assign(MappedStorage<ForcingType>::scratch(disk_cache.get_directory(), forcing_grid.size()), forcing_grid.lat_count,
+                            forcing_grid.lon_count);
+                last.data().advise(MappedFile::Advice::SEQUENTIAL);
+            } else {
+                last.resize(0, forcing_grid.lat_count, forcing_grid.lon_count);
+            }
+            account_last();
+        } else if (!forcing_grid.is_compatible(last_grid) || forcing_grid.lat_count != last_grid.lat_count || forcing_grid.lon_count != last_grid.lon_count) {
+            throw std::runtime_error(filename + ": Incompatible grids");
+        }
     }
-    std::size_t chunk_pos = chunk_size;
-    std::vector<ForcingType> chunk_buffer(chunk_size * forcing_grid.size());
-    progressbar::ProgressBar time_bar(time_variable.times.size(), filename, true);
-    std::vector<ForcingType> region_forcing(regions.size());
-    for (std::size_t t = 0; t < time_variable.times.size(); ++t) {
-        if (chunk_pos == chunk_size) {
-            forcing_variable.getVar(
-                {t, 0, 0},
-                {t + chunk_size > time_variable.times.size() ? time_variable.times.size() - t : chunk_size, forcing_grid.lat_count, forcing_grid.lon_count},
-                &chunk_buffer[0]);
-            chunk_pos = 0;
+    std::size_t lat_begin;
+    std::size_t lon_begin;
+    const auto read_grid = proxy_subgrid(forcing_grid, lat_begin, lon_begin);  // only read part of forcing relevant for regions
+    RegionPoints points;
+    if (use_points) {
+        points = region_points(forcing_grid, forcing_gathering, read_grid, lat_begin, lon_begin);
+        remap_last_points(points);
+    }
+    ForcingReader reader = forcing_gathering.empty()
+                               ? ForcingReader(forcing_file, forcing_variable, forcing_grid, chunk_size, read_grid, lat_begin, lon_begin, &arena)
+                               : ForcingReader(forcing_file, forcing_variable, points.read_begin, points.read_count, chunk_size, &arena);
+    progressbar::ProgressCounter time_bar(time_variable.times.size(), filename);
+    Metrics::instance().begin_join(time_variable.times.size());
+    auto region_forcing = arena.take<ForcingType>("region_forcing", regions.size());
+    const auto cell_forcing = [&](int i, ForcingType proxy_value, ForcingType forcing_v, ForcingType& last_v) {
+        auto rec = recovery_exponent * last_v;
+        if (rec < recovery_threshold || rec > 1e10 || std::isnan(rec)) {
+            rec = 0;
         }
-        nvector::View<ForcingType, 2> forcing_values(
-            std::begin(chunk_buffer) + chunk_pos * forcing_grid.size(),
-            {nvector::Slice{0, forcing_grid.lat_count, static_cast<int>(forcing_grid.lon_count)}, nvector::Slice{0, forcing_grid.lon_count, 1}});
-        ++chunk_pos;
+        const auto v = std::min(forcing_v + rec, ForcingType(1.0));
+        region_forcing[i] += v * proxy_value;
+        last_v = v;
+    };
+    reader.foreach_slice({}, time_variable.offset, time_variable.times.size(), [&](std::size_t t, const auto& forcing_values) {
         std::fill(std::begin(region_forcing), std::end(region_forcing), 0);
-        GeoGrid<float> common_grid;
-        nvector::foreach_view(common_grid_view(common_grid, GridView<int>{isoraster, isoraster_grid}, GridView<ForcingType>{proxy_values, proxy_grid},
-                                               GridView<ForcingType>{forcing_values, forcing_grid}, GridView<ForcingType>{last, forcing_grid}),
-                              [&](std::size_t lat_index, std::size_t lon_index, int i, ForcingType proxy_value, ForcingType forcing_v, ForcingType& last_v) {
-                                  (void)lat_index;
-                                  (void)lon_index;
-                                  if (forcing_v > 1e10 || proxy_value <= 0 || i < 0 || std::isnan(forcing_v) || std::isnan(proxy_value)) {
-                                      return true;
-                                  }
-                                  auto rec = recovery_exponent * last_v;
-                                  if (rec < recovery_threshold || rec > 1e10 || std::isnan(rec)) {
-                                      rec = 0;
-                                  }
-                                  const auto v = std::min(forcing_v + rec, ForcingType(1.0));
-                                  region_forcing[i] += v * proxy_value;
-                                  last_v = v;
-                                  return true;
-                              });
+        if (use_points) {
+            foreach_point(points, forcing_values, [&](std::size_t p, int i, ForcingType proxy_value, ForcingType forcing_v) {
+                if (forcing_v <= max_valid_forcing) {
+                    cell_forcing(i, proxy_value, forcing_v, last_points[p]);
+                }
+            });
+        } else {
+            GeoGrid<float> common_grid;
+            nvector::foreach_view(
+                common_grid_view(common_grid, make_grid_view(isoraster->values, isoraster->grid), make_grid_view(proxy->values, proxy->grid),
+                                 make_grid_view(forcing_values, read_grid), make_grid_view(last, forcing_grid)),
+                [&](std::size_t lat_index, std::size_t lon_index, int i, ForcingType proxy_value, ForcingType forcing_v, ForcingType& last_v) {
+                    (void)lat_index;
+                    (void)lon_index;
+                    if (!(forcing_v <= max_valid_forcing) || proxy_value <= 0 || i < 0 || std::isnan(proxy_value)) {
+                        return true;
+                    }
+                    cell_forcing(i, proxy_value, forcing_v, last_v);
+                    return true;
+                });
+        }
+        if (time_variable.is_dropped(t)) {  // still computed above as flooded fractions carry over to the following time steps
+            ++time_bar;
+            Metrics::instance().end_join_step();
+            return;
+        }
         AgentForcing& forcing = forcing_series.insert_forcing(time_variable.times[t]);
         for (std::size_t i = 0; i < regions.size(); ++i) {
             const auto region = regions[i];
@@ -131,10 +167,31 @@ void Flooding::join(Output& output, const TemplateFunction& template_func) {
             }
         }
         ++time_bar;
-    }
-    output.include_forcing(forcing_series);
-    time_bar.close(true);
+        Metrics::instance().end_join_step();
+    });
+    arena.give_back("region_forcing", std::move(region_forcing));
+    output.include_forcing(std::move(forcing_series));
+    time_bar.close();
     last_grid = forcing_grid;
 }
 
+void Flooding::remap_last_points(const RegionPoints& points) {
+    if (points.cells == last_cells) {
+        return;
+    }
+    std::unordered_map<std::size_t, ForcingType> previous;
+    for (std::size_t p = 0; p < last_cells.size(); ++p) {
+        previous.emplace(last_cells[p], last_points[p]);
+    }
+    last_points.assign(points.size(), 0);
+    for (std::size_t p = 0; p < points.size(); ++p) {
+        const auto it = previous.find(points.cells[p]);
+        if (it != std::end(previous)) {
+            last_points[p] = it->second;
+        }
+    }
+    last_cells = points.cells;
+    account_last();
+}
+
 }  // namespace impactgen
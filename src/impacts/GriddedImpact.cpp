@@ -20,8 +20,12 @@
 
 #include "impacts/GriddedImpact.h"
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include "Gathering.h"
+#include "InputFile.h"
+#include "Profiling.h"
 #include "netcdftools.h"
 
 namespace impactgen {
@@ -29,32 +33,43 @@ namespace impactgen {
 void GriddedImpact::read_isoraster(const settings::SettingsNode& isoraster_node, const std::unordered_map<std::string, std::size_t>& all_regions) {
     const auto& isoraster_filename = isoraster_node["file"].as<std::string>();
     const auto& isoraster_varname = isoraster_node["variable"].as<std::string>();
-    netCDF::NcFile isoraster_file;
-    try {
-        isoraster_file.open(isoraster_filename, netCDF::NcFile::read);
-    } catch (netCDF::exceptions::NcException& e) {
-        throw std::runtime_error(isoraster_filename + ": " + e.what());
-    }
-    const auto isoraster_variable = isoraster_file.getVar(isoraster_varname);
-    if (isoraster_variable.isNull()) {
-        throw std::runtime_error("Variable '" + isoraster_varname + "' not found in " + isoraster_filename);
-    }
-    isoraster_grid.read_from_netcdf(isoraster_file, isoraster_filename);
-    isoraster.resize(-1, isoraster_grid.lat_count, isoraster_grid.lon_count);
-    isoraster_variable.getVar({0, 0}, {isoraster_grid.lat_count, isoraster_grid.lon_count}, &isoraster.data()[0]);
     const auto& isoraster_index_varname = isoraster_node["index"].as<std::string>("index");
-    const auto isoraster_regions_variable = isoraster_file.getVar(isoraster_index_varname);
-    if (isoraster_regions_variable.isNull()) {
-        throw std::runtime_error("Variable '" + isoraster_index_varname + "' not found in " + isoraster_filename);
-    }
-    if (!check_dimensions(isoraster_variable, {"lat", "lon"}) && !check_dimensions(isoraster_variable, {"latitude", "longitude"})) {
-        throw std::runtime_error(isoraster_filename + " - " + isoraster_varname + ": Unexpected dimensions");
-    }
-    std::vector<char*> isoraster_regions(isoraster_regions_variable.getDim(0).getSize());
-    isoraster_regions_variable.getVar({0}, {isoraster_regions.size()}, &isoraster_regions[0]);
-    regions.reserve(isoraster_regions.size());
+    isoraster = GridCache::instance().get<GridData<int>>(isoraster_filename, isoraster_varname + ":" + isoraster_index_varname, [&]() {
+        IMPACTGEN_PROFILE("read_isoraster");
+        auto res = std::make_shared<GridData<int>>();
+        InputFile isoraster_file(isoraster_filename);
+        const auto isoraster_variable = isoraster_file.getVar(isoraster_varname);
+        if (isoraster_variable.isNull()) {
+            throw std::runtime_error("Variable '" + isoraster_varname + "' not found in " + isoraster_filename);
+        }
+        res->grid.read_from_netcdf(isoraster_file, isoraster_filename);
+        if (read_gathering(isoraster_file, isoraster_variable, res->grid, isoraster_filename, res->gathered)) {
+            if (isoraster_variable.getDimCount() != 1) {
+                throw std::runtime_error(isoraster_filename + " - " + isoraster_varname + ": Unexpected dimensions");
+            }
+            res->values.resize(-1, 1, res->gathered.size());
+            isoraster_variable.getVar({0}, {res->gathered.size()}, &res->values.data()[0]);
+        } else {
+            if (!check_dimensions(isoraster_variable, {"lat", "lon"}) && !check_dimensions(isoraster_variable, {"latitude", "longitude"})) {
+                throw std::runtime_error(isoraster_filename + " - " + isoraster_varname + ": Unexpected dimensions");
+            }
+            res->values.resize(-1, res->grid.lat_count, res->grid.lon_count);
+            isoraster_variable.getVar({0, 0}, {res->grid.lat_count, res->grid.lon_count}, &res->values.data()[0]);
+            res->grid.to_canonical(res->values);
+        }
+        const auto isoraster_regions_variable = isoraster_file.getVar(isoraster_index_varname);
+        if (isoraster_regions_variable.isNull()) {
+            throw std::runtime_error("Variable '" + isoraster_index_varname + "' not found in " + isoraster_filename);
+        }
+        std::vector<char*> isoraster_regions(isoraster_regions_variable.getDim(0).getSize());
+        isoraster_regions_variable.getVar({0}, {isoraster_regions.size()}, &isoraster_regions[0]);
+        res->names.assign(std::begin(isoraster_regions), std::end(isoraster_regions));
+        return res;
+    });
+    isoraster_id = isoraster_filename + ":" + isoraster_varname + "@" + std::to_string(GridCache::modification_time(isoraster_filename));
+    regions.reserve(isoraster->names.size());
     bool verbose = isoraster_node["verbose"].as<bool>(false);
-    for (const auto& region_name : isoraster_regions) {
+    for (const auto& region_name : isoraster->names) {
         const auto& region = all_regions.find(region_name);
         if (region == std::end(all_regions)) {
             if (verbose) {
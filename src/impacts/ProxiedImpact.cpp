@@ -19,13 +19,49 @@
 */
 
 #include "impacts/ProxiedImpact.h"
+#include <algorithm>
 #include <cmath>
+#include <iostream>
+#include <memory>
 #include <string>
+#include "Gathering.h"
 #include "GeoGrid.h"
+#include "InputFile.h"
+#include "Profiling.h"
+#include "Remapping.h"
 #include "settingsnode.h"
 
 namespace impactgen {
 
+void ProxyTotals::to_disk_cache(const std::string& source_filename, const std::string& key) const {
+    const ForcingType sums[2] = {sum, sum_all};
+    DiskCache::instance().store(source_filename, key,
+                                {{sums, sizeof(sums)},
+                                 {per_region.data(), per_region.size() * sizeof(ForcingType)},
+                                 {region_boxes.data(), region_boxes.size() * sizeof(GeoBox<float>)}});
+}
+
+bool ProxyTotals::from_disk_cache(const DiskCache::Entry& entry) {
+    if (entry.section_count() != 3) {
+        return false;
+    }
+    std::size_t count;
+    const auto* sums = entry.section<ForcingType>(0, count);
+    if (count != 2) {
+        return false;
+    }
+    sum = sums[0];
+    sum_all = sums[1];
+    const auto* cached_per_region = entry.section<ForcingType>(1, count);
+    per_region.assign(cached_per_region, cached_per_region + count);
+    const auto* cached_region_boxes = entry.section<GeoBox<float>>(2, count);
+    if (count != per_region.size()) {
+        return false;
+    }
+    region_boxes.assign(cached_region_boxes, cached_region_boxes + count);
+    return true;
+}
+
 ProxiedImpact::ProxiedImpact(const settings::SettingsNode& proxy_node) {
     proxy_filename = proxy_node["file"].as<std::string>();
     proxy_varname = proxy_node["variable"].as<std::string>();
@@ -33,64 +69,220 @@ ProxiedImpact::ProxiedImpact(const settings::SettingsNode& proxy_node) {
 }
 
 void ProxiedImpact::read_proxy(const std::string& filename, const std::vector<std::string>& all_regions) {
-    netCDF::NcFile proxy_file;
-    try {
-        proxy_file.open(filename, netCDF::NcFile::read);
-    } catch (netCDF::exceptions::NcException& e) {
-        throw std::runtime_error(filename + ": " + e.what());
+    if (filename == current_proxy_filename) {
+        return;
     }
-    const auto proxy_variable = proxy_file.getVar(proxy_varname);
-    if (proxy_variable.isNull()) {
-        throw std::runtime_error(filename + ": Variable '" + proxy_varname + "' not found");
-    }
-    if (!check_dimensions(proxy_variable, {"lat", "lon"}) && !check_dimensions(proxy_variable, {"latitude", "longitude"})) {
-        throw std::runtime_error(filename + " - " + proxy_varname + ": Unexpected dimensions");
-    }
-    proxy_grid.read_from_netcdf(proxy_file, filename);
-    proxy_values.resize(0, proxy_grid.lat_count, proxy_grid.lon_count);
-    proxy_variable.getVar({0, 0}, {proxy_grid.lat_count, proxy_grid.lon_count}, &proxy_values.data()[0]);
-    if (!proxy_grid.is_compatible(isoraster_grid)) {
-        throw std::runtime_error("Forcing and proxy not compatible in raster resolution");
-    }
-
-    total_proxy.resize(regions.size());
-    std::fill(std::begin(total_proxy), std::end(total_proxy), 0);  // reset proxy (cannot do with resize if called a second time)
-    {
-        ForcingType total_proxy_sum = 0.0;
-        ForcingType total_proxy_sum_all = 0.0;
+    proxy = GridCache::instance().get<GridData<ForcingType>>(filename, proxy_varname, [&]() {
+        IMPACTGEN_PROFILE("read_proxy");
+        auto res = std::make_shared<GridData<ForcingType>>();
+        InputFile proxy_file(filename);
+        const auto proxy_variable = proxy_file.getVar(proxy_varname);
+        if (proxy_variable.isNull()) {
+            throw std::runtime_error(filename + ": Variable '" + proxy_varname + "' not found");
+        }
+        res->grid.read_from_netcdf(proxy_file, filename);
+        if (read_gathering(proxy_file, proxy_variable, res->grid, filename, res->gathered)) {
+            if (proxy_variable.getDimCount() != 1) {
+                throw std::runtime_error(filename + " - " + proxy_varname + ": Unexpected dimensions");
+            }
+            res->values.resize(0, 1, res->gathered.size());
+            proxy_variable.getVar({0}, {res->gathered.size()}, &res->values.data()[0]);
+            return res;
+        }
+        if (!check_dimensions(proxy_variable, {"lat", "lon"}) && !check_dimensions(proxy_variable, {"latitude", "longitude"})) {
+            throw std::runtime_error(filename + " - " + proxy_varname + ": Unexpected dimensions");
+        }
+        res->values.resize(0, res->grid.lat_count, res->grid.lon_count);
+        proxy_variable.getVar({0, 0}, {res->grid.lat_count, res->grid.lon_count}, &res->values.data()[0]);
+        res->grid.to_canonical(res->values);
+        return res;
+    });
 
+    const auto totals = GridCache::instance().get<ProxyTotals>(filename, proxy_varname + "|" + isoraster_id, [&]() {
+        IMPACTGEN_PROFILE("proxy_totals");
+        auto res = std::make_shared<ProxyTotals>();
+        res->per_region.resize(regions.size(), 0);
+        res->region_boxes.resize(regions.size());
+        if (proxy->is_gathered() || isoraster->is_gathered() || !proxy->grid.is_compatible(isoraster->grid)) {
+            const GridCells isoraster_cells(isoraster->grid, isoraster->gathered);
+            const GridCells proxy_cells(proxy->grid, proxy->gathered);
+            const ConservativeRemapping remapping(proxy_cells, isoraster_cells);
+            std::vector<ConservativeRemapping::Piece> pieces;
+            for (std::size_t position = 0; position < proxy_cells.size(); ++position) {
+                const auto v = proxy->values.data()[position];
+                if (v <= 0 || std::isnan(v)) {
+                    continue;
+                }
+                res->sum_all += v;
+                remapping.pieces(position, pieces);
+                for (const auto& piece : pieces) {
+                    if (piece.target1 == GridCells::npos) {
+                        continue;
+                    }
+                    const auto i = isoraster->values.data()[piece.target1];
+                    if (i < 0) {
+                        continue;
+                    }
+                    const auto share = static_cast<ForcingType>(v * piece.fraction);
+                    res->per_region[i] += share;
+                    res->region_boxes[i].extend(piece.lat, piece.lon);
+                    res->sum += share;
+                }
+            }
+            return res;
+        }
         GeoGrid<float> common_grid;
-        nvector::foreach_view(common_grid_view(common_grid, GridView<int>{isoraster, isoraster_grid}, GridView<ForcingType>{proxy_values, proxy_grid}),
+        nvector::foreach_view(common_grid_view(common_grid, make_grid_view(isoraster->values, isoraster->grid),
+                                               make_grid_view(proxy->values, proxy->grid)),
                               [&](std::size_t lat_index, std::size_t lon_index, int i, ForcingType v) {
-                                  (void)lat_index;
-                                  (void)lon_index;
                                   if (v <= 0 || std::isnan(v)) {
                                       return true;
                                   }
-                                  total_proxy_sum_all += v;
+                                  res->sum_all += v;
                                   if (i < 0) {
                                       return true;
                                   }
-                                  total_proxy[i] += v;
-                                  total_proxy_sum += v;
+                                  res->per_region[i] += v;
+                                  res->region_boxes[i].extend(common_grid.lat(lat_index), common_grid.lon(lon_index));
+                                  res->sum += v;
                                   return true;
                               });
-        if (verbose) {
-            std::cout << "Total proxy sum: " << total_proxy_sum << " (" << total_proxy_sum_all << ")" << std::endl;
-            for (std::size_t i = 0; i < regions.size(); ++i) {
-                const auto region = regions[i];
-                if (region < 0) {
-                    continue;
-                }
-                const auto total_proxy_value = total_proxy[i];
-                if (total_proxy_value <= 0) {
-                    std::cerr << "Warning: " << all_regions[region] << " has zero proxy" << std::endl;
-                } else {
-                    std::cout << all_regions[region] << ": " << total_proxy_value << std::endl;
-                }
+        return res;
+    });
+    total_proxy = totals->per_region;
+    proxy_box = GeoBox<float>();
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+        if (regions[i] >= 0 && total_proxy[i] > 0) {
+            proxy_box.extend(totals->region_boxes[i]);
+        }
+    }
+    current_proxy_filename = filename;
+
+    if (verbose) {
+        std::cout << "Total proxy sum: " << totals->sum << " (" << totals->sum_all << ")" << std::endl;
+        for (std::size_t i = 0; i < regions.size(); ++i) {
+            const auto region = regions[i];
+            if (region < 0) {
+                continue;
+            }
+            const auto total_proxy_value = total_proxy[i];
+            if (total_proxy_value <= 0) {
+                std::cerr << "Warning: " << all_regions[region] << " has zero proxy" << std::endl;
+            } else {
+                std::cout << all_regions[region] << ": " << total_proxy_value << std::endl;
+            }
+        }
+    }
+}
+
+GeoGrid<float> ProxiedImpact::proxy_subgrid(const GeoGrid<float>& forcing_grid, std::size_t& lat_begin, std::size_t& lon_begin) const {
+    if (proxy_box.empty()) {
+        lat_begin = 0;
+        lon_begin = 0;
+        return forcing_grid;
+    }
+    return forcing_grid.subgrid(proxy_box, lat_begin, lon_begin);
+}
+
+bool ProxiedImpact::use_region_points(const GeoGrid<float>& forcing_grid, const std::vector<std::size_t>& forcing_gathering) const {
+    return !forcing_gathering.empty() || proxy->is_gathered() || isoraster->is_gathered() || !all_compatible(forcing_grid, proxy->grid, isoraster->grid);
+}
+
+RegionPoints ProxiedImpact::region_points(const GeoGrid<float>& forcing_grid,
+                                          const std::vector<std::size_t>& forcing_gathering,
+                                          const GeoGrid<float>& read_grid,
+                                          std::size_t lat_begin,
+                                          std::size_t lon_begin) {
+    std::string key = current_proxy_filename;
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char*>(&forcing_grid), sizeof(forcing_grid));
+    key.append(reinterpret_cast<const char*>(&read_grid), sizeof(read_grid));
+    key.append(reinterpret_cast<const char*>(&lat_begin), sizeof(lat_begin));
+    key.append(reinterpret_cast<const char*>(&lon_begin), sizeof(lon_begin));
+    key.append(reinterpret_cast<const char*>(forcing_gathering.data()), forcing_gathering.size() * sizeof(std::size_t));
+    if (key == region_points_key) {
+        return region_points_cache;
+    }
+    IMPACTGEN_PROFILE("region_points");
+
+    struct Point {
+        std::size_t forcing_position;
+        int i;
+        double weight;
+    };
+    std::vector<Point> points;
+    const GridCells isoraster_cells(isoraster->grid, isoraster->gathered);
+    const GridCells proxy_cells(proxy->grid, proxy->gathered);
+    const GridCells forcing_cells(forcing_grid, forcing_gathering);
+    const ConservativeRemapping remapping(proxy_cells, isoraster_cells, &forcing_cells);
+    std::vector<ConservativeRemapping::Piece> pieces;
+    for (std::size_t position = 0; position < proxy_cells.size(); ++position) {
+        const auto v = proxy->values.data()[position];
+        if (v <= 0 || std::isnan(v)) {
+            continue;
+        }
+        remapping.pieces(position, pieces);
+        for (const auto& piece : pieces) {
+            if (piece.target1 == GridCells::npos || piece.target2 == GridCells::npos) {
+                continue;
+            }
+            const auto i = isoraster->values.data()[piece.target1];
+            if (i < 0 || regions[i] < 0) {
+                continue;
+            }
+            points.push_back(Point{piece.target2, i, v * piece.fraction});
+        }
+    }
+    // ascending positions for sequential access to forcing values, merging pieces of the same forcing cell and region into one weight
+    std::sort(std::begin(points), std::end(points), [](const Point& a, const Point& b) {
+        return a.forcing_position < b.forcing_position || (a.forcing_position == b.forcing_position && a.i < b.i);
+    });
+    std::size_t merged = 0;
+    for (std::size_t p = 0; p < points.size(); ++p) {
+        if (merged > 0 && points[merged - 1].forcing_position == points[p].forcing_position && points[merged - 1].i == points[p].i) {
+            points[merged - 1].weight += points[p].weight;
+        } else {
+            points[merged++] = points[p];
+        }
+    }
+    points.resize(merged);
+
+    RegionPoints res;
+    if (!forcing_gathering.empty()) {
+        if (points.empty()) {
+            res.read_count = 1;  // still read (and ignore) one value per time step
+        } else {
+            res.read_begin = points.front().forcing_position;
+            res.read_count = points.back().forcing_position - res.read_begin + 1;
+        }
+    }
+    res.cells.reserve(points.size());
+    res.rows.reserve(points.size());
+    res.cols.reserve(points.size());
+    res.isoraster_indices.reserve(points.size());
+    res.proxy_values.reserve(points.size());
+    for (const auto& point : points) {
+        if (forcing_gathering.empty()) {
+            const auto lat_index = point.forcing_position / forcing_grid.lon_count;
+            const auto lon_index = point.forcing_position % forcing_grid.lon_count;
+            if (lat_index < lat_begin || lat_index >= lat_begin + read_grid.lat_count || lon_index < lon_begin
+                || lon_index >= lon_begin + read_grid.lon_count) {
+                continue;
             }
+            res.rows.push_back(lat_index - lat_begin);
+            res.cols.push_back(lon_index - lon_begin);
+        } else {
+            res.rows.push_back(0);
+            res.cols.push_back(point.forcing_position - res.read_begin);
         }
+        res.cells.push_back(forcing_cells.flat_index(point.forcing_position));
+        res.isoraster_indices.push_back(point.i);
+        res.proxy_values.push_back(static_cast<ForcingType>(point.weight));
     }
+    region_points_key = std::move(key);
+    region_points_cache = res;
+    region_points_memory.set(region_points_cache.memory_size());
+    return res;
 }
 
 }  // namespace impactgen
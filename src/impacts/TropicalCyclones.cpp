@@ -25,6 +25,9 @@
 #include <limits>
 #include <stdexcept>
 #include <string>
+#include "ForcingReader.h"
+#include "InputFile.h"
+#include "Metrics.h"
 #include "Output.h"
 #include "TimeVariable.h"
 #include "helpers.h"
@@ -88,16 +91,14 @@ TropicalCyclones::TropicalCyclones(  // NOLINT(cert-msc32-c,cert-msc51-cpp) [rep
 
 void TropicalCyclones::join(Output& output, const TemplateFunction& template_func) {
     auto filename = fill_template(forcing_filename, template_func);
-    netCDF::NcFile forcing_file;
-    try {
-        forcing_file.open(filename, netCDF::NcFile::read);
-    } catch (netCDF::exceptions::NcException& e) {
-        throw std::runtime_error(filename + ": " + e.what());
-    }
+    InputFile forcing_file(filename);
     const auto forcing_variable = forcing_file.getVar(forcing_varname);
     if (forcing_variable.isNull()) {
         throw std::runtime_error(filename + ": Variable '" + forcing_varname + "' not found");
     }
+    if (check_dimensions(forcing_variable, {"realization", "year", "event", ""})) {
+        throw std::runtime_error(filename + " - " + forcing_varname + ": Gathered (land-only) wind fields not supported as storm footprints extend over sea");
+    }
     if (!check_dimensions(forcing_variable, {"realization", "year", "event", "lat", "lon"})
         && !check_dimensions(forcing_variable, {"realization", "year", "event", "latitude", "longitude"})) {
         throw std::runtime_error(filename + " - " + forcing_varname + ": Unexpected dimensions");
@@ -110,9 +111,6 @@ void TropicalCyclones::join(Output& output, const TemplateFunction& template_fun
     // TimeVariable time_variable(forcing_file, filename, time_shift);
     GeoGrid<float> forcing_grid;
     forcing_grid.read_from_netcdf(forcing_file, filename);
-    if (!isoraster_grid.is_compatible(forcing_grid)) {
-        throw std::runtime_error(filename + ": Forcing and ISO raster not compatible in raster resolution");
-    }
 
     read_proxy(fill_template(proxy_filename, template_func), output.get_regions());
 
@@ -142,11 +140,20 @@ void TropicalCyclones::join(Output& output, const TemplateFunction& template_fun
         years_variable.getVar({0}, {years.size()}, &years[0]);
     }
 
-    std::vector<ForcingType> chunk_buffer(chunk_size * forcing_grid.size());
-    auto forcing_series = ForcingSeries<AgentForcing>(base_forcing, ReferenceTime(ReferenceTime::year(year_from), 24 * 60 * 60));
-    std::vector<ForcingType> region_forcing(regions.size());
+    const bool use_points = use_region_points(forcing_grid, {});
+    RegionPoints points;
+    if (use_points) {
+        points = region_points(forcing_grid, {}, forcing_grid, 0, 0);
+    }
+    ForcingReader reader(forcing_file, forcing_variable, forcing_grid, chunk_size, &arena);
+    const auto calendar = output.ref().get_calendar();
+    auto forcing_series = ForcingSeries<AgentForcing>(base_forcing, ReferenceTime(ReferenceTime::year(year_from, calendar), 24 * 60 * 60, calendar));
+    forcing_series.set_pool(forcing_pool);
+    auto region_forcing = arena.take<ForcingType>("region_forcing", regions.size());
+    const auto range = time_range.intersect(output.get_time_range());
 
-    progressbar::ProgressBar year_bar(year_to - year_from + 1, filename, true);
+    progressbar::ProgressCounter year_bar(year_to - year_from + 1, filename);
+    Metrics::instance().begin_join(year_to - year_from + 1);
     for (int year = year_from; year <= year_to; ++year) {
         const auto year_it = std::find(std::begin(years), std::end(years), year);
         if (year_it == std::end(years)) {
@@ -158,45 +165,57 @@ void TropicalCyclones::join(Output& output, const TemplateFunction& template_fun
         events_variable.getVar({realization, year_index}, {1, 1}, &events_cnt_read);
         const std::size_t events_cnt = events_cnt_read;
 
-        std::size_t chunk_pos = chunk_size;
-        progressbar::ProgressBar event_bar(events_cnt, "Events", true);
-        for (std::size_t event = 0; event < events_cnt; ++event) {
-            if (chunk_pos == chunk_size) {
-                forcing_variable.getVar(
-                    {realization, year_index, event, 0, 0},
-                    {1, 1, event + chunk_size > events_cnt ? events_cnt - event : chunk_size, forcing_grid.lat_count, forcing_grid.lon_count},
-                    &chunk_buffer[0]);
-                chunk_pos = 0;
-            }
-            nvector::View<ForcingType, 2> forcing_values(
-                std::begin(chunk_buffer) + chunk_pos * forcing_grid.size(),
-                {nvector::Slice{0, forcing_grid.lat_count, static_cast<int>(forcing_grid.lon_count)}, nvector::Slice{0, forcing_grid.lon_count, 1}});
-            ++chunk_pos;
+        progressbar::ProgressCounter event_bar(events_cnt, "Events");
+        reader.foreach_slice({realization, year_index}, 0, events_cnt, [&](std::size_t event, const auto& forcing_values) {
+            (void)event;
             std::fill(std::begin(region_forcing), std::end(region_forcing), 0);
             std::size_t lat_min = std::numeric_limits<std::size_t>::max();
             std::size_t lat_max = 0;
             std::size_t lon_min = std::numeric_limits<std::size_t>::max();
             std::size_t lon_max = 0;
+            const auto extend_footprint = [&](std::size_t lat_index, std::size_t lon_index) {
+                lat_min = std::min(lat_min, lat_index);
+                lat_max = std::max(lat_max, lat_index);
+                lon_min = std::min(lon_min, lon_index);
+                lon_max = std::max(lon_max, lon_index);
+            };
             GeoGrid<float> common_grid;
-            nvector::foreach_view(common_grid_view(common_grid, GridView<int>{isoraster, isoraster_grid}, GridView<ForcingType>{proxy_values, proxy_grid},
-                                                   GridView<ForcingType>{forcing_values, forcing_grid}),
-                                  [&](std::size_t lat_index, std::size_t lon_index, int i, ForcingType proxy_value, ForcingType forcing_v) {
-                                      if (forcing_v > 1e10 || std::isnan(forcing_v)) {
-                                          return true;
-                                      }
-                                      if (forcing_v >= threshold) {
-                                          lat_min = std::min(lat_min, lat_index);
-                                          lat_max = std::max(lat_max, lat_index);
-                                          lon_min = std::min(lon_min, lon_index);
-                                          lon_max = std::max(lon_max, lon_index);
-                                          if (proxy_value <= 0 || i < 0 || std::isnan(proxy_value)) {
+            if (use_points) {
+                // footprint over whole forcing grid (including ocean), damages only on points
+                const auto& lat_slice = forcing_values.template slice<0>();
+                const auto& lon_slice = forcing_values.template slice<1>();
+                for (std::size_t lat_index = 0; lat_index < lat_slice.size; ++lat_index) {
+                    for (std::size_t lon_index = 0; lon_index < lon_slice.size; ++lon_index) {
+                        const ForcingType forcing_v = forcing_values(lat_index, lon_index);
+                        if (forcing_v <= max_valid_forcing && forcing_v >= threshold) {
+                            extend_footprint(lat_index, lon_index);
+                        }
+                    }
+                }
+                foreach_point(points, forcing_values, [&](std::size_t p, int i, ForcingType proxy_value, ForcingType forcing_v) {
+                    (void)p;
+                    if (forcing_v <= max_valid_forcing && forcing_v >= threshold) {
+                        region_forcing[i] += proxy_value;
+                    }
+                });
+            } else {
+                nvector::foreach_view(common_grid_view(common_grid, make_grid_view(isoraster->values, isoraster->grid),
+                                                       make_grid_view(proxy->values, proxy->grid), make_grid_view(forcing_values, forcing_grid)),
+                                      [&](std::size_t lat_index, std::size_t lon_index, int i, ForcingType proxy_value, ForcingType forcing_v) {
+                                          if (!(forcing_v <= max_valid_forcing)) {
                                               return true;
                                           }
-                                          region_forcing[i] += proxy_value;
-                                      }
-                                      return true;
-                                  });
-            AgentForcing forcing(base_forcing);
+                                          if (forcing_v >= threshold) {
+                                              extend_footprint(lat_index, lon_index);
+                                              if (proxy_value <= 0 || i < 0 || std::isnan(proxy_value)) {
+                                                  return true;
+                                              }
+                                              region_forcing[i] += proxy_value;
+                                          }
+                                          return true;
+                                      });
+            }
+            AgentForcing forcing = forcing_pool->take(base_forcing);
             for (std::size_t i = 0; i < regions.size(); ++i) {
                 const auto region = regions[i];
                 if (region < 0) {
@@ -211,22 +230,31 @@ void TropicalCyclones::join(Output& output, const TemplateFunction& template_fun
                     forcing(sector, region) = (total_proxy_value - r) / total_proxy_value;
                 }
             }
-            const auto duration = static_cast<int>(
-                std::ceil(distance(common_grid.lon(lon_min), common_grid.lat(lat_min), common_grid.lon(lon_min), common_grid.lat(lat_max)) / velocity / 24));
+            const auto footprint_lon = use_points ? forcing_grid.lon(lon_min) : common_grid.lon(lon_min);
+            const auto footprint_lat_from = use_points ? forcing_grid.lat(lat_min) : common_grid.lat(lat_min);
+            const auto footprint_lat_to = use_points ? forcing_grid.lat(lat_max) : common_grid.lat(lat_max);
+            const auto duration =
+                static_cast<int>(std::ceil(distance(footprint_lon, footprint_lat_from, footprint_lon, footprint_lat_to) / velocity / 24));
             const auto& season = seasons.at(basin);
             std::uniform_int_distribution<int> distribution(season.first, season.second - duration);
             const auto start = distribution(random_generator);
-            const auto base_time = ReferenceTime::year(year);
+            const auto base_time = ReferenceTime::year(year, calendar);
             for (std::time_t t = start; t < start + duration; ++t) {
-                forcing_series.insert_forcing(base_time + t * 24 * 60 * 60, forcing, ForcingCombination::ADD);
+                const auto time = base_time + t * 24 * 60 * 60;
+                if (range.contains(time, calendar)) {  // events are still drawn for the whole period so that random sequence does not change
+                    forcing_series.insert_forcing(time, forcing_pool->take(forcing), ForcingCombination::ADD);
+                }
             }
+            forcing_pool->give_back(std::move(forcing));
             ++event_bar;
-        }
-        event_bar.close(true);
+        });
+        event_bar.close();
         ++year_bar;
+        Metrics::instance().end_join_step(events_cnt);
     }
-    output.include_forcing(forcing_series);
-    year_bar.close(true);
+    arena.give_back("region_forcing", std::move(region_forcing));
+    output.include_forcing(std::move(forcing_series));
+    year_bar.close();
 }
 
 }  // namespace impactgen
@@ -18,13 +18,21 @@
   <http://www.gnu.org/licenses/>.
 */
 
+#include <unistd.h>
 #include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include "DiskCache.h"
+#include "Generator.h"
+#include "GridCache.h"
+#include "MemoryAccounting.h"
+#include "Metrics.h"
 #include "Output.h"
+#include "Profiling.h"
 #include "helpers.h"
 #include "impacts/Flooding.h"
 #include "impacts/HeatLaborProductivity.h"
@@ -41,6 +49,17 @@ extern const char* impactgen_git_diff;
 extern const char* impactgen_info;
 
 static void run(const settings::SettingsNode& settings) {
+    if (settings.has("cache")) {
+        const auto& cache_node = settings["cache"];
+        impactgen::GridCache::instance().set_memory_limit(cache_node["memory_limit"].as<std::size_t>(1024) * 1024 * 1024);  // in MiB
+        if (cache_node.has("directory")) {
+            impactgen::DiskCache::instance().set_directory(cache_node["directory"].as<std::string>(), cache_node["verify_hash"].as<bool>(false));
+        }
+    }
+    if (settings.has("metrics")) {
+        const auto& metrics_node = settings["metrics"];
+        impactgen::Metrics::instance().start(metrics_node["socket"].as<std::string>(""), metrics_node["port"].as<int>(9464));
+    }
     impactgen::Output output(settings);
     output.add_regions(settings["regions"]);
     output.add_sectors(settings["sectors"]);
@@ -48,7 +67,7 @@ static void run(const settings::SettingsNode& settings) {
     std::vector<settings::SettingsNode> impact_nodes;
     auto sequence = settings["impacts"].as_sequence();
     std::copy(std::begin(sequence), std::end(sequence), std::back_inserter(impact_nodes));
-    progressbar::ProgressBar all_impacts_bar(impact_nodes.size(), "Impacts");
+    progressbar::ProgressCounter all_impacts_bar(impact_nodes.size(), "Impacts");
     for (const auto& impact_node : impact_nodes) {
         std::unique_ptr<impactgen::Impact> impact;
         std::string impact_name;
@@ -95,9 +114,26 @@ static void run(const settings::SettingsNode& settings) {
                 }
             }
         }
-        progressbar::ProgressBar impact_bar(combination_count, impact_name, true);
+        progressbar::ProgressCounter impact_bar(combination_count, impact_name);
+        impactgen::Metrics::instance().begin_impact(impact_name, combination_count);
         bool loop = true;
         while (loop) {
+#ifdef IMPACTGEN_PROFILING
+            std::vector<std::string> combination;
+            for (const auto& var : range_variables) {
+                combination.push_back(var.first + "=" + std::to_string(std::get<0>(var.second)));
+            }
+            for (const auto& var : sequence_variables) {
+                combination.push_back(var.first + "=" + std::get<1>(var.second)[std::get<0>(var.second)]);
+            }
+            std::sort(std::begin(combination), std::end(combination));
+            std::string combination_name;
+            for (const auto& var : combination) {
+                combination_name += (combination_name.empty() ? "" : ",") + var;
+            }
+            IMPACTGEN_PROFILE_CONTEXT(impact_name, combination_name);
+            IMPACTGEN_PROFILE("join");
+#endif
             impact->join(output, [&](const std::string& key, const std::string& temp) -> std::string {
                 const auto& value = range_variables.find(key);
                 if (value == std::end(range_variables)) {
@@ -135,12 +171,112 @@ static void run(const settings::SettingsNode& settings) {
                 }
             }
             ++impact_bar;
+            impactgen::Metrics::instance().end_combination();
         }
-        impact_bar.close(true);
+        impact_bar.close();
+        impactgen::Metrics::instance().end_impact();
         ++all_impacts_bar;
     }
+    IMPACTGEN_PROFILE_CONTEXT("", "");
     output.close();
     all_impacts_bar.close();
+    impactgen::Metrics::instance().stop();
+    if (impactgen::MemoryAccounting::instance().get_limit() > 0) {
+        impactgen::MemoryAccounting::instance().write_report(std::cerr);
+    }
+#ifdef IMPACTGEN_PROFILING
+    if (settings.has("profiling")) {
+        const auto& profiling_node = settings["profiling"];
+        if (profiling_node.has("summary")) {
+            impactgen::profiling::Profiler::instance().write_summary(profiling_node["summary"].as<std::string>());
+        }
+        if (profiling_node.has("trace")) {
+            impactgen::profiling::Profiler::instance().write_trace(profiling_node["trace"].as<std::string>());
+        }
+    }
+#endif
+}
+
+static void generate(const settings::SettingsNode& settings) {
+    impactgen::Generator::Parameters parameters;
+    parameters.resolution = settings["resolution"].as<double>(parameters.resolution);
+    if (settings.has("extent")) {
+        const auto& extent_node = settings["extent"];
+        parameters.extent.lat_min = extent_node["lat_min"].as<double>();
+        parameters.extent.lat_max = extent_node["lat_max"].as<double>();
+        parameters.extent.lon_min = extent_node["lon_min"].as<double>();
+        parameters.extent.lon_max = extent_node["lon_max"].as<double>();
+    }
+    parameters.region_count = settings["regions"].as<std::size_t>(parameters.region_count);
+    parameters.sector_count = settings["sectors"].as<std::size_t>(parameters.sector_count);
+    parameters.timestep_count = settings["timesteps"].as<std::size_t>(parameters.timestep_count);
+    parameters.realization_count = settings["realizations"].as<std::size_t>(parameters.realization_count);
+    if (settings.has("years")) {
+        const auto& years_node = settings["years"];
+        parameters.year_from = years_node["from"].as<int>();
+        const auto year_to = years_node["to"].as<int>();
+        if (parameters.year_from > year_to) {
+            throw std::runtime_error("years: 'from' value should be less than 'to' value");
+        }
+        parameters.year_count = year_to - parameters.year_from + 1;
+    }
+    parameters.event_count = settings["events"].as<std::size_t>(parameters.event_count);
+    parameters.land_fraction = settings["land_fraction"].as<double>(parameters.land_fraction);
+    parameters.compression_level = settings["compression"].as<int>(parameters.compression_level);
+    parameters.seed = settings["seed"].as<std::uint64_t>(parameters.seed);
+    const impactgen::Generator generator(parameters);
+    const auto& files_node = settings["files"];
+    for (const auto& file : files_node.as_map()) {
+        const auto filename = file.second.as<std::string>();
+        switch (settings::hstring(file.first)) {
+            case settings::hstring::hash("isoraster"):
+                generator.write_isoraster(filename);
+                break;
+            case settings::hstring::hash("proxy"):
+                generator.write_proxy(filename);
+                break;
+            case settings::hstring::hash("flood_fraction"):
+                generator.write_flood_fraction(filename);
+                break;
+            case settings::hstring::hash("temperature"):
+                generator.write_temperature(filename);
+                break;
+            case settings::hstring::hash("tropical_cyclones"):
+                generator.write_tropical_cyclones(filename);
+                break;
+            default:
+                throw std::runtime_error("Unknown generated file type '" + file.first + "'");
+        }
+    }
+}
+
+static settings::SettingsNode read_settings(const std::string& filename) {
+    if (filename == "-") {
+        std::cin >> std::noskipws;
+        return settings::SettingsNode(std::make_unique<settings::YAML>(std::cin));
+    }
+    std::ifstream settings_file(filename);
+    if (!settings_file) {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    return settings::SettingsNode(std::make_unique<settings::YAML>(settings_file));
+}
+
+// mode is one of "bars", "jsonl", "jsonl:<fd>" or "none"
+static bool set_progress_mode(const std::string& mode) {
+    auto& reporter = progressbar::ProgressReporter::instance();
+    if (mode == "bars") {
+        reporter.configure(progressbar::ProgressReporter::Mode::BARS);
+    } else if (mode == "none") {
+        reporter.configure(progressbar::ProgressReporter::Mode::SILENT);
+    } else if (mode == "jsonl") {
+        reporter.configure(progressbar::ProgressReporter::Mode::JSONL, stdout, STDOUT_FILENO);
+    } else if (mode.compare(0, 6, "jsonl:") == 0 && mode.size() > 6 && std::all_of(std::begin(mode) + 6, std::end(mode), ::isdigit)) {
+        reporter.configure(progressbar::ProgressReporter::Mode::JSONL, stdout, std::stoi(mode.substr(6)));
+    } else {
+        return false;
+    }
+    return true;
 }
 
 static void print_usage(const char* program_name) {
@@ -152,23 +288,62 @@ static void print_usage(const char* program_name) {
                  "\n"
                  "Usage:   "
               << program_name
-              << " (<option> | <settingsfile>)\n"
+              << " (<option> | [--progress=<mode>] [--memory-limit=<MiB>] (<settingsfile> | generate <generatorsettingsfile>))\n"
                  "Options:\n"
 #ifdef IMPACTGEN_HAS_DIFF
                  "  -d, --diff     Print git diff output from compilation\n"
 #endif
                  "  -h, --help     Print this help text\n"
-                 "  -v, --version  Print version"
+                 "  -v, --version  Print version\n"
+                 "Progress modes:\n"
+                 "  bars           Progress bars on standard output (default unless built with IMPACTGEN_PROGRESSBARS_SILENT)\n"
+                 "  jsonl[:<fd>]   Progress events as JSON lines to file descriptor fd (default: standard output)\n"
+                 "  none           No progress output\n"
+                 "Memory limit:\n"
+                 "  Above 90% of the limit caches are evicted, chunks shrink and output series are combined early;\n"
+                 "  exceeding the limit aborts. Peak memory by subsystem is reported at the end"
               << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        print_usage(argv[0]);
+    const char* program_name = argv[0];
+    while (argc > 1) {
+        const std::string option = argv[1];
+        if (option.compare(0, 11, "--progress=") == 0) {
+            if (!set_progress_mode(option.substr(11))) {
+                print_usage(program_name);
+                return 1;
+            }
+        } else if (option.compare(0, 15, "--memory-limit=") == 0) {
+            const auto value = option.substr(15);
+            if (value.empty() || !std::all_of(std::begin(value), std::end(value), ::isdigit)) {
+                print_usage(program_name);
+                return 1;
+            }
+            impactgen::MemoryAccounting::instance().set_limit(std::stoull(value) << 20);
+        } else {
+            break;
+        }
+        --argc;
+        ++argv;
+    }
+    if (argc != 2 && (argc != 3 || std::string(argv[1]) != "generate")) {
+        print_usage(program_name);
         return 1;
     }
     const std::string arg = argv[1];
-    if (arg.length() > 1 && arg[0] == '-') {
+    if (argc == 3) {
+#ifndef DEBUG
+        try {
+#endif
+            generate(read_settings(argv[2]));
+#ifndef DEBUG
+        } catch (std::runtime_error& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 255;
+        }
+#endif
+    } else if (arg.length() > 1 && arg[0] == '-') {
         if (arg == "--version" || arg == "-v") {
             std::cout << IMPACTGEN_VERSION << std::endl;
 #ifdef IMPACTGEN_HAS_DIFF
@@ -176,25 +351,16 @@ int main(int argc, char* argv[]) {
             std::cout << impactgen_git_diff << std::flush;
 #endif
         } else if (arg == "--help" || arg == "-h") {
-            print_usage(argv[0]);
+            print_usage(program_name);
         } else {
-            print_usage(argv[0]);
+            print_usage(program_name);
             return 1;
         }
     } else {
 #ifndef DEBUG
         try {
 #endif
-            if (arg == "-") {
-                std::cin >> std::noskipws;
-                run(settings::SettingsNode(std::make_unique<settings::YAML>(std::cin)));
-            } else {
-                std::ifstream settings_file(arg);
-                if (!settings_file) {
-                    throw std::runtime_error("Cannot open " + arg);
-                }
-                run(settings::SettingsNode(std::make_unique<settings::YAML>(settings_file)));
-            }
+            run(read_settings(arg));
 #ifndef DEBUG
         } catch (std::runtime_error& ex) {
             std::cerr << ex.what() << std::endl;
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include "Calendar.h"
+#include "ReferenceTime.h"
+
+using namespace impactgen;
+
+static int failures = 0;
+
+static void check_date(const char* name, std::time_t time, Calendar calendar, const calendar::Date& expected) {
+    const auto date = calendar::to_date(calendar, time);
+    if (date.year != expected.year || date.month != expected.month || date.day != expected.day) {
+        std::cerr << name << ": got " << date.year << "-" << date.month << "-" << date.day << ", expected " << expected.year << "-" << expected.month
+                  << "-" << expected.day << std::endl;
+        ++failures;
+    }
+}
+
+int main() {
+    // noleap input with standard output
+    const ReferenceTime input("days since 1860-01-01", Calendar::NOLEAP);
+    check_date("noleap reference", calendar::convert(Calendar::NOLEAP, Calendar::STANDARD, input.unreference(0)), Calendar::STANDARD, {1860, 1, 1});
+    const auto t2010 = input.reference(calendar::to_time(Calendar::NOLEAP, {2010, 1, 1}));
+    check_date("noleap 2010", calendar::convert(Calendar::NOLEAP, Calendar::STANDARD, input.unreference(t2010)), Calendar::STANDARD, {2010, 1, 1});
+    check_date("noleap 2010-12-31", calendar::convert(Calendar::NOLEAP, Calendar::STANDARD, calendar::to_time(Calendar::NOLEAP, {2010, 12, 31}, 12)),
+               Calendar::STANDARD, {2010, 12, 31});
+    if (calendar::convert(Calendar::NOLEAP, Calendar::STANDARD, calendar::to_time(Calendar::NOLEAP, {2010, 3, 1}, 6, 30))
+        != calendar::to_time(Calendar::STANDARD, {2010, 3, 1}, 6, 30)) {
+        std::cerr << "time of day not kept" << std::endl;
+        ++failures;
+    }
+
+    // dates missing in target calendar are mapped to the closest earlier valid day of the same month
+    if (calendar::exists(Calendar::STANDARD, {2001, 2, 30}) || calendar::exists(Calendar::NOLEAP, {2004, 2, 29})
+        || !calendar::exists(Calendar::DAY360, {2001, 2, 30}) || !calendar::exists(Calendar::STANDARD, {2004, 2, 29})) {
+        std::cerr << "wrong date existence" << std::endl;
+        ++failures;
+    }
+    check_date("360_day February 30 to standard", calendar::convert(Calendar::DAY360, Calendar::STANDARD, calendar::to_time(Calendar::DAY360, {2001, 2, 30})),
+               Calendar::STANDARD, {2001, 2, 28});
+    check_date("360_day February 29 to standard leap year",
+               calendar::convert(Calendar::DAY360, Calendar::STANDARD, calendar::to_time(Calendar::DAY360, {2004, 2, 30})), Calendar::STANDARD, {2004, 2, 29});
+    check_date("standard 31st to 360_day", calendar::convert(Calendar::STANDARD, Calendar::DAY360, calendar::to_time(Calendar::STANDARD, {2001, 1, 31})),
+               Calendar::DAY360, {2001, 1, 30});
+    check_date("standard February 29 to noleap", calendar::convert(Calendar::STANDARD, Calendar::NOLEAP, calendar::to_time(Calendar::STANDARD, {2004, 2, 29})),
+               Calendar::NOLEAP, {2004, 2, 28});
+    check_date("proleptic_gregorian February 29 to noleap",
+               calendar::convert(Calendar::PROLEPTIC_GREGORIAN, Calendar::NOLEAP, calendar::to_time(Calendar::PROLEPTIC_GREGORIAN, {1600, 2, 29})),
+               Calendar::NOLEAP, {1600, 2, 28});
+    check_date("standard March 1 to noleap", calendar::convert(Calendar::STANDARD, Calendar::NOLEAP, calendar::to_time(Calendar::STANDARD, {2004, 3, 1})),
+               Calendar::NOLEAP, {2004, 3, 1});
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cerr << "done" << std::endl;
+    return 0;
+}
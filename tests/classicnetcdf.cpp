@@ -0,0 +1,198 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "ClassicNetCDF.h"
+
+using namespace impactgen;
+
+static int failures = 0;
+
+static void check(bool condition, int format, const char* what) {
+    if (!condition) {
+        std::cerr << "CDF-" << format << ": " << what << std::endl;
+        ++failures;
+    }
+}
+
+// writes big-endian header fields and data as laid out in netCDF classic files
+struct Writer {
+    int format;
+    std::string out;
+
+    template<typename T>
+    void value(T v) {
+        typename std::conditional<sizeof(T) == 2, std::uint16_t, typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type>::type raw;
+        std::memcpy(&raw, &v, sizeof(T));
+        for (std::size_t i = sizeof(T); i > 0; --i) {
+            out.push_back(static_cast<char>((raw >> (8 * (i - 1))) & 0xFF));
+        }
+    }
+    void pad() {
+        while (out.size() % 4 != 0) {
+            out.push_back('\0');
+        }
+    }
+    void non_neg(std::uint64_t v) { format == 5 ? value<std::uint64_t>(v) : value<std::uint32_t>(v); }
+    void offset(std::uint64_t v) { format == 1 ? value<std::uint32_t>(v) : value<std::uint64_t>(v); }
+    void name(const std::string& s) {
+        non_neg(s.size());
+        out += s;
+        pad();
+    }
+};
+
+// file with dimensions time (record, 2 records), lat (2), lon (3); a global text attribute (of unpadded length); variables
+//   lat(lat) double, tas(time, lat, lon) float, flag(time, lon) short (record size 6 bytes, padded to 8)
+static std::string fixture(int format) {
+    const auto header = [&](std::uint64_t data_begin) {
+        Writer w{format, std::string("CDF") + static_cast<char>(format)};
+        w.non_neg(2);  // numrecs
+        w.value<std::uint32_t>(0x0A);
+        w.non_neg(3);
+        w.name("time");
+        w.non_neg(0);
+        w.name("lat");
+        w.non_neg(2);
+        w.name("lon");
+        w.non_neg(3);
+        w.value<std::uint32_t>(0x0C);
+        w.non_neg(1);
+        w.name("title");
+        w.value<std::uint32_t>(2);  // CHAR
+        w.non_neg(5);
+        w.out += "hello";
+        w.pad();
+        w.value<std::uint32_t>(0x0B);
+        w.non_neg(3);
+        // lat
+        w.name("lat");
+        w.non_neg(1);
+        w.non_neg(1);
+        w.value<std::uint32_t>(0);
+        w.non_neg(0);
+        w.value<std::uint32_t>(6);  // DOUBLE
+        w.non_neg(16);
+        w.offset(data_begin);
+        // tas
+        w.name("tas");
+        w.non_neg(3);
+        w.non_neg(0);
+        w.non_neg(1);
+        w.non_neg(2);
+        w.value<std::uint32_t>(0);
+        w.non_neg(0);
+        w.value<std::uint32_t>(5);  // FLOAT
+        w.non_neg(24);
+        w.offset(data_begin + 16);
+        // flag
+        w.name("flag");
+        w.non_neg(2);
+        w.non_neg(0);
+        w.non_neg(2);
+        w.value<std::uint32_t>(0);
+        w.non_neg(0);
+        w.value<std::uint32_t>(3);  // SHORT
+        w.non_neg(8);
+        w.offset(data_begin + 16 + 24);
+        return w;
+    };
+    auto w = header(0);
+    w = header(w.out.size());
+    w.value<double>(-45.0);
+    w.value<double>(45.0);
+    for (int r = 0; r < 2; ++r) {
+        for (int i = 0; i < 6; ++i) {
+            w.value<float>(100.0f * r + i);
+        }
+        for (int i = 0; i < 3; ++i) {
+            w.value<std::int16_t>(static_cast<std::int16_t>(-10 * r - i));
+        }
+        w.pad();
+    }
+    return w.out;
+}
+
+int main() {
+    for (const int format : {1, 2, 5}) {
+        const auto buffer = fixture(format);
+        check(ClassicNetCDF::is_classic(buffer.data(), buffer.size()), format, "not detected as classic");
+        const ClassicNetCDF file("fixture", buffer.data(), buffer.size());
+        check(file.record_count() == 2, format, "record count");
+        check(file.dimensions().size() == 3 && file.dimensions()[0].size == 0 && file.dimensions()[2].name == "lon", format, "dimensions");
+        const auto* lat = file.variable("lat");
+        const auto* tas = file.variable("tas");
+        const auto* flag = file.variable("flag");
+        if (lat == nullptr || tas == nullptr || flag == nullptr || file.variable("missing") != nullptr) {
+            check(false, format, "variables");
+            continue;
+        }
+        check(!lat->is_record && tas->is_record && flag->is_record, format, "record variables");
+        check(file.dimension_size(*tas, 0) == 2 && file.dimension_size(*tas, 1) == 2 && file.dimension_size(*tas, 2) == 3, format, "dimension sizes");
+
+        const auto lat_view = file.slice<double>(*lat, {});
+        check(lat_view.size(0) == 1 && lat_view.size(1) == 2 && lat_view(0, 0) == -45.0 && lat_view(0, 1) == 45.0, format, "non-record values");
+
+        for (std::size_t r = 0; r < 2; ++r) {
+            const auto view = file.slice<float>(*tas, {r});
+            bool ok = view.size(0) == 2 && view.size(1) == 3;
+            for (std::size_t i = 0; ok && i < 2; ++i) {
+                for (std::size_t j = 0; j < 3; ++j) {
+                    ok = ok && view(i, j) == 100.0f * r + i * 3 + j;
+                }
+            }
+            check(ok, format, "record values");
+
+            const auto part = file.slice<float>(*tas, {r}, 1, 1, 1, 2);
+            check(part.size(0) == 1 && part.size(1) == 2 && part(0, 0) == 100.0f * r + 4 && part(0, 1) == 100.0f * r + 5, format, "subslice");
+
+            std::vector<std::int16_t> flags(3);
+            file.read_slice(*flag, {r}, 0, 1, 0, 3, reinterpret_cast<char*>(flags.data()));
+            check(flags[0] == -10 * static_cast<int>(r) && flags[2] == -10 * static_cast<int>(r) - 2, format, "padded record values");
+        }
+
+        bool thrown = false;
+        try {
+            file.slice<float>(*tas, {2});
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, format, "record index out of bounds");
+
+        thrown = false;
+        try {
+            const ClassicNetCDF truncated("truncated", buffer.data(), buffer.size() - 4);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, format, "truncated file");
+    }
+    if (failures > 0) {
+        return 1;
+    }
+    std::cerr << "done" << std::endl;
+    return 0;
+}
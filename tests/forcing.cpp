@@ -0,0 +1,147 @@
+/*
+  Copyright (C) 2019 Sven Willner <sven.willner@pik-potsdam.de>
+
+  This file is part of the Acclimate ImpactGen.
+
+  Acclimate ImpactGen is free software: you can redistribute it and/or
+  modify it under the terms of the GNU Affero General Public License
+  as published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate ImpactGen is distributed in the hope that it will be
+  useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public
+  License along with Acclimate ImpactGen.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "AgentForcing.h"
+#include "Forcing.h"
+
+using namespace impactgen;
+
+static int failures = 0;
+
+static const char* name(ForcingCombination combination) {
+    switch (combination) {
+        case ForcingCombination::ADD:
+            return "ADD";
+        case ForcingCombination::MAX:
+            return "MAX";
+        case ForcingCombination::MIN:
+            return "MIN";
+        case ForcingCombination::MULT:
+            return "MULT";
+    }
+    return "";
+}
+
+// compares n-ary include with repeated pairwise include (results have to be identical as values are combined in the same order)
+static void check_combination(const std::vector<AgentForcing>& operands, ForcingCombination combination, bool quantized) {
+    AgentForcing pairwise = operands.front();
+    AgentForcing nary = operands.front();
+    std::vector<const AgentForcing*> others;
+    for (std::size_t k = 1; k < operands.size(); ++k) {
+        others.push_back(&operands[k]);
+    }
+    if (quantized) {
+        pairwise.quantize();
+        nary.quantize();
+    }
+    for (const auto other : others) {
+        pairwise.include(*other, combination);
+    }
+    nary.include(others, combination);
+    if (quantized ? pairwise.get_quantized_data() != nary.get_quantized_data() : pairwise.get_data() != nary.get_data()) {
+        std::cerr << name(combination) << (quantized ? " (quantized)" : "") << ": n-ary result differs from pairwise result" << std::endl;
+        ++failures;
+    }
+}
+
+int main() {
+    // more than one block of combine
+    std::vector<std::string> regions(2000);
+    for (std::size_t r = 0; r < regions.size(); ++r) {
+        regions[r] = "R" + std::to_string(r);
+    }
+    const AgentForcing base({"S1", "S2", "S3"}, regions);
+    std::vector<AgentForcing> operands(4, base);
+    unsigned int state = 1;
+    for (auto& forcing : operands) {
+        for (std::size_t s = 0; s < 3; ++s) {
+            for (std::size_t r = 0; r < regions.size(); ++r) {
+                state = state * 1103515245 + 12345;
+                forcing(s, r) = static_cast<ForcingType>((state >> 16) % 1001) / 1000;
+            }
+        }
+    }
+
+    for (const auto combination : {ForcingCombination::ADD, ForcingCombination::MAX, ForcingCombination::MIN, ForcingCombination::MULT}) {
+        check_combination(operands, combination, false);
+        check_combination(operands, combination, true);
+    }
+
+    // ADD is clamped to max(a + b - 1, 0)
+    {
+        AgentForcing a = base;
+        AgentForcing b = base;
+        a(0, 0) = 0.25;
+        b(0, 0) = 0.5;
+        a(0, 1) = 0.75;
+        b(0, 1) = 0.5;
+        a.include(b, ForcingCombination::ADD);
+        if (a(0, 0) != 0 || a(0, 1) != 0.25 || a(0, 2) != 1) {
+            std::cerr << "ADD: got " << a(0, 0) << ", " << a(0, 1) << ", " << a(0, 2) << ", expected 0, 0.25, 1" << std::endl;
+            ++failures;
+        }
+        const QuantizedForcingType clamped = Combiner<ForcingCombination::ADD, QuantizedForcingType>::apply(1000, 2000);
+        const QuantizedForcingType identity = Combiner<ForcingCombination::ADD, QuantizedForcingType>::apply(1000, quantization::max_value);
+        if (clamped != 0 || identity != 1000) {
+            std::cerr << "quantized ADD: got " << clamped << ", " << identity << ", expected 0, 1000" << std::endl;
+            ++failures;
+        }
+    }
+
+    // quantization round trip
+    {
+        const ForcingType values[] = {0.0, 1.0, std::numeric_limits<ForcingType>::quiet_NaN(), 0.5};
+        QuantizedForcingType encoded[4];
+        ForcingType decoded[4];
+        quantization::encode(values, encoded, 4);
+        if (encoded[0] != 0 || encoded[1] != 65534 || encoded[2] != 65535 || encoded[2] != quantization::fill_value) {
+            std::cerr << "encode: got " << encoded[0] << ", " << encoded[1] << ", " << encoded[2] << ", expected 0, 65534, 65535" << std::endl;
+            ++failures;
+        }
+        quantization::decode(encoded, decoded, 4);
+        if (decoded[0] != 0 || decoded[1] != 1 || !std::isnan(decoded[2]) || std::abs(decoded[3] - 0.5) > quantization::scale_factor) {
+            std::cerr << "decode: got " << decoded[0] << ", " << decoded[1] << ", " << decoded[2] << ", " << decoded[3] << ", expected 0, 1, nan, 0.5"
+                      << std::endl;
+            ++failures;
+        }
+        // missing values stay missing when combined
+        for (const auto combination : {ForcingCombination::ADD, ForcingCombination::MAX, ForcingCombination::MIN, ForcingCombination::MULT}) {
+            QuantizedForcingType data[] = {quantization::fill_value, 0, quantization::max_value};
+            const QuantizedForcingType operand[] = {0, quantization::fill_value, quantization::max_value};
+            const QuantizedForcingType* others = operand;
+            combine(data, &others, 1, 3, combination);
+            if (data[0] != quantization::fill_value || data[1] != quantization::fill_value || data[2] != quantization::max_value) {
+                std::cerr << name(combination) << " (quantized): missing value not propagated" << std::endl;
+                ++failures;
+            }
+        }
+    }
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cerr << "done" << std::endl;
+    return 0;
+}